@@ -7,8 +7,12 @@ static const unsigned int borderpx  = 1;        /* border pixel of windows */
 static const unsigned int snap      = 16;       /* snap pixel */
 static const int showbar            = 1;        /* 0 means no bar */
 static const int topbar             = 0;        /* 0 means bottom bar */
+static const int hideiconic         = 1;        /* 1 means unmap hidden clients as IconicState, 0 moves them off-screen */
 static const char *fonts[]          = { "sans-serif:size=10" };
 static const char dmenufont[]       = "sans-serif:size=15";
+static const uint prewarmslice      = 2000; /* µs of bar font pre-warming per idle loop */
+static const uint syncwait          = 100;  /* ms a mouse resize waits for the client to paint */
+static const uint edgepx            = 8;    /* width of the strips along the sides monitors share */
 static const char col_sel1[]        = "#00bbff";
 static const char col_sel2[]        = "#f32f7c";
 static const char col_sel3[]        = "#afff00";
@@ -82,6 +86,23 @@ static const uint max_disp_init  = 0;    /* num of max clients. 0 means showing
 static const int resizehints     = 1;    /* 1 means respect size hints in tiled resizals */
 static const int lockfullscreen  = 1;    /* 1 will force focus on the fullscreen window */
 
+/* Processes of clients whose WM_CLASS class or instance is listed here are
+ * stopped once all their windows have been hidden for freezegrace seconds,
+ * and resumed before one of them is shown again. */
+static const char *freezeclasses[] = { NULL /* e.g. "firefox", "Chromium" */ };
+static const uint freezegrace    = 30;   /* seconds */
+
+/* windows of a spawned command are placed on the workspace and pane it
+ * was spawned from, when they appear within launchwait seconds */
+static const uint launchwait     = 30;   /* seconds */
+
+/* sources of the built-in status modules */
+static const char sysbattery[]   = "BAT0";          /* /sys/class/power_supply */
+static const char sysnetiface[]  = "wlan0";         /* /sys/class/net */
+static const char sysdisk[]      = "/";             /* mount point */
+static const char systhermal[]   = "thermal_zone0"; /* /sys/class/thermal */
+static const uint statusslack    = 50;              /* ms a status run may move to share a wakeup */
+
 static const Layout layouts[] = {
   /* symbol   arrange function */
   { "v",  tile_v },
@@ -105,7 +126,8 @@ static const Layout layouts[] = {
 #define FNKEYS(KEY,IDX)							\
   { MODKEY,              KEY,  togglepane,         {.ui = IDX} },	\
   { MODKEY|ShiftMask,    KEY,  moveclient_paneidx, {.ui = IDX - 1} },	\
-  { MODKEY|ControlMask,  KEY,  set_bar_status,     {.ui = IDX - 1} }
+  { MODKEY|ControlMask,  KEY,  set_bar_status,     {.ui = IDX - 1} },	\
+  { MODKEY|AltMask,      KEY,  pin_bar_status,     {.ui = IDX - 1} }
 
 /* commands */
 static char dmenumon[2] = "0"; /* component of dmenucmd, manipulated in spawn() */
@@ -120,6 +142,15 @@ static const char *dmenucmd[] = {
   NULL };
 static const char *termcmd[]  = { "st", NULL };
 
+/* Commands started ahead of time and held unmapped, on no workspace,
+ * until spawn() runs the same command: one of them is then shown in the
+ * selected pane at once and another started in its place. An instance
+ * that grows past maxrss KiB (0 for no limit) while held is stopped. */
+static const PoolCmd poolcmds[] = {
+  /* cmd       size  maxrss */
+  { termcmd,   1,    131072 },
+};
+
 static Key keys[] = {
   /* modifier              key              function              argument */
   { MODKEY|ACSMask,        XK_BackSpace,    quit,                 {0} },
@@ -219,48 +250,58 @@ static Button buttons[] = {
   { ClkClientWin,          MODKEY,         Button3,        resizemouse,    {0} },
 };
 
-void barstatus_datetime_est(Monitor *m) {
-  barstatus_datetime(m, "EST", ":EST");
+uint status_datetime_est(Segment *segs, uint n) {
+  return status_datetime(segs, n, "EST", ":EST");
+}
+uint status_datetime_ict(Segment *segs, uint n) {
+  return status_datetime(segs, n, "ICT", ":Asia/Bangkok");
 }
-void barstatus_datetime_ict(Monitor *m) {
-  barstatus_datetime(m, "ICT", ":Asia/Bangkok");
+uint status_datetime_jst(Segment *segs, uint n) {
+  return status_datetime(segs, n, "JST", ":Asia/Tokyo");
 }
-void barstatus_datetime_jst(Monitor *m) {
-  barstatus_datetime(m, "JST", ":Asia/Tokyo");
+uint status_datetime_utc(Segment *segs, uint n) {
+  return status_datetime(segs, n, "UTC", ":UTC");
 }
-void barstatus_datetime_utc(Monitor *m) {
-  barstatus_datetime(m, "UTC", ":UTC");
+
+/* the frames dzwmstatus -s 0 publishes */
+uint status_shm0(Segment *segs, uint n) {
+  return status_shm(segs, n, 0);
 }
 
-void barstatus_test1(Monitor *m) {
-  barstatus_command(m, "cat ~/dzwm-status.txt");
+uint status_test1(Segment *segs, uint n) {
+  return status_command(segs, n, "cat ~/dzwm-status.txt");
 }
 
-void barstatus_test2(Monitor *m) {
-  barstatus_file(m, "dzwm-status.txt");
+uint status_test2(Segment *segs, uint n) {
+  return status_file(segs, n, "dzwm-status.txt");
 }
 
+/* render draws on the bar when it is shown; update runs in the background
+ * on its own, and the bar shows its last result. intervals are in ms.
+ * pinned modules are shown next to the selected one from the start, maxw
+ * (pixels, 0 for no limit) caps the room each takes. */
 static const StatusRenderSpec statusrenderspecs[] = {
-  {"🪟", barstatus_wintitle,      0},
-  {"📌", barstatus_workspaces,    0},
-  {"📆", barstatus_datetime_ict,  0},
-  {"📆", barstatus_datetime_est,  0},
-  {"📆", barstatus_datetime_utc,  0},
-  {"📆", barstatus_datetime_jst,  0},
-  {"📃", barstatus_test1,         5},
-  {"🔖", barstatus_test2,         5},
-  {"💥", barstatus_dummy,        99},
-  {"💫", barstatus_dummy,        99},
-  {"💦", barstatus_dummy,        99},
-  {"🚀", barstatus_dummy,        99},
-  {"🔥", barstatus_dummy,        99},
-  {"💧", barstatus_dummy,        99},
-  {"💡", barstatus_dummy,        99},
-  {"💬", barstatus_dummy,        99},
-  {"🎃", barstatus_dummy,        99},
-  {"🔋", barstatus_dummy,        99},
-  {"🔊", barstatus_dummy,        99},
-  {"📢", barstatus_dummy,        99},
-  {"📝", barstatus_dummy,        99},
-  {"⚙️", barstatus_dummy,        99},
+  /* icon  render                  update                interval  maxw  pinned */
+  {"🪟", barstatus_wintitle,      NULL,                      0,    0,  0},
+  {"📌", barstatus_workspaces,    NULL,                      0,    0,  0},
+  {"📆", NULL,                    status_datetime_ict,    1000,    0,  1},
+  {"📆", NULL,                    status_datetime_est,    1000,    0,  0},
+  {"📆", NULL,                    status_datetime_utc,    1000,    0,  0},
+  {"📆", NULL,                    status_datetime_jst,    1000,    0,  0},
+  {"📃", NULL,                    status_test1,           5000,  400,  0},
+  {"🔖", NULL,                    status_test2,           5000,  400,  0},
+  {"💥", NULL,                    status_cpu,             1000,    0,  1},
+  {"💫", NULL,                    status_mem,             2000,    0,  0},
+  {"💦", NULL,                    status_load,            5000,    0,  0},
+  {"🚀", NULL,                    status_net,             1000,    0,  0},
+  {"🔥", NULL,                    status_thermal,         2000,    0,  0},
+  {"💧", NULL,                    status_disk,           30000,    0,  0},
+  {"💡", barstatus_dummy,         NULL,                      0,    0,  0},
+  {"💬", NULL,                    status_shm0,               0,  400,  0},
+  {"🎃", barstatus_dummy,         NULL,                      0,    0,  0},
+  {"🔋", NULL,                    status_battery,        30000,    0,  1},
+  {"🔊", barstatus_dummy,         NULL,                      0,    0,  0},
+  {"📢", barstatus_dummy,         NULL,                      0,    0,  0},
+  {"📊", barstatus_stats,         NULL,                   1000,  500,  0},
+  {"⚙️", barstatus_dummy,         NULL,                      0,    0,  0},
 };
@@ -1,14 +1,26 @@
 /* See LICENSE file for copyright and license details. */
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include <X11/Xlib.h>
 #include <X11/Xft/Xft.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "drw.h"
 #include "util.h"
 
 #define UTF_INVALID 0xFFFD
+#define ADV_UNKNOWN (-2)   /* Fnt.ascii entry not measured yet */
+#define ADV_MISSING (-1)   /* the font has no glyph for it */
 
 static int
 utf8decode(const char *s_in, long *u, int *err)
@@ -46,6 +58,114 @@ utf8decode(const char *s_in, long *u, int *err)
   return len;
 }
 
+static XftDraw *
+xftdraw(Drw *drw)
+{
+  if (!drw->xftdraw)
+    drw->xftdraw = XftDrawCreate(drw->dpy, drw->drawable,
+				 DefaultVisual(drw->dpy, drw->screen),
+				 DefaultColormap(drw->dpy, drw->screen));
+  return drw->xftdraw;
+}
+
+static int
+overlaps(const XRectangle *a, const XRectangle *b)
+{
+  return a->x < b->x + b->width && b->x < a->x + a->width
+    && a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static void
+drawlist_flush(Drw *drw)
+{
+  DrawList *dl = drw->dl;
+  XRectangle rects[DRAWLIST_FILLS];
+  XftGlyphFontSpec specs[DRAWLIST_GLYPHS];
+  unsigned char done[DRAWLIST_FILLS] = { 0 };
+  unsigned int i, j, n;
+
+  for (i = 0; i < dl->nfills; i++) {
+    if (done[i])
+      continue;
+    for (j = i, n = 0; j < dl->nfills; j++) {
+      if (!done[j] && dl->fills[j].pixel == dl->fills[i].pixel) {
+	rects[n++] = dl->fills[j].r;
+	done[j] = 1;
+      }
+    }
+    XSetForeground(drw->dpy, drw->gc, dl->fills[i].pixel);
+    XFillRectangles(drw->dpy, drw->drawable, drw->gc, rects, n);
+  }
+  for (i = 0; i < dl->ncolors; i++) {
+    for (j = 0, n = 0; j < dl->nglyphs; j++)
+      if (dl->glyphcolor[j] == i)
+	specs[n++] = dl->glyphs[j];
+    XftDrawGlyphFontSpec(xftdraw(drw), &dl->colors[i], specs, n);
+  }
+  dl->nfills = dl->ntexts = dl->nglyphs = dl->ncolors = 0;
+}
+
+static void
+drawlist_fill(Drw *drw, unsigned long pixel, int x, int y, unsigned int w, unsigned int h)
+{
+  DrawList *dl = drw->dl;
+  XRectangle r = { x, y, w, h };
+  unsigned int i;
+
+  if (!w || !h)
+    return;
+  if (dl->nfills == DRAWLIST_FILLS)
+    drawlist_flush(drw);
+  for (i = 0; i < dl->ntexts; i++)
+    if (overlaps(&r, &dl->texts[i]))
+      break;
+  if (i < dl->ntexts)
+    drawlist_flush(drw);
+  for (i = 0; i < dl->nfills; i++)
+    if (dl->fills[i].pixel != pixel && overlaps(&r, &dl->fills[i].r))
+      break;
+  if (i < dl->nfills)
+    drawlist_flush(drw);
+  dl->fills[dl->nfills].pixel = pixel;
+  dl->fills[dl->nfills++].r = r;
+}
+
+/* queue n glyphs drawn in color within the area x, y, w, h */
+static void
+drawlist_glyphs(Drw *drw, const XftColor *col, const XftGlyphFontSpec *specs,
+		unsigned int n, int x, int y, unsigned int w, unsigned int h)
+{
+  DrawList *dl = drw->dl;
+  XRectangle r = { x, y, w, h };
+  unsigned int i, c;
+
+  for (c = 0; c < dl->ncolors && dl->colors[c].pixel != col->pixel; c++);
+  if (dl->nglyphs + n > DRAWLIST_GLYPHS || dl->ntexts == DRAWLIST_TEXTS
+      || c == DRAWLIST_COLORS) {
+    drawlist_flush(drw);
+    c = 0;
+  }
+  if (c == dl->ncolors)
+    dl->colors[dl->ncolors++] = *col;
+  dl->texts[dl->ntexts++] = r;
+  for (i = 0; i < n; i++) {
+    dl->glyphs[dl->nglyphs] = specs[i];
+    dl->glyphcolor[dl->nglyphs++] = c;
+  }
+}
+
+static void
+runcache_clear(RunCache *rc)
+{
+  unsigned int i;
+
+  for (i = 0; i < rc->n; i++) {
+    free(rc->runs[i].text);
+    free(rc->runs[i].specs);
+  }
+  rc->n = 0;
+}
+
 Drw *
 drw_create(Display *dpy, int screen, Window root, unsigned int w, unsigned int h)
 {
@@ -58,8 +178,20 @@ drw_create(Display *dpy, int screen, Window root, unsigned int w, unsigned int h
   drw->h = h;
   drw->drawable = XCreatePixmap(dpy, root, w, h, DefaultDepth(dpy, screen));
   drw->gc = XCreateGC(dpy, root, 0, NULL);
+  drw->fc = ecalloc(1, sizeof(FontCache));
+  drw->rc = ecalloc(1, sizeof(RunCache));
+  drw->dl = ecalloc(1, sizeof(DrawList));
   XSetLineAttributes(dpy, drw->gc, 1, LineSolid, CapButt, JoinMiter);
 
+  if (pipe(drw->fm.pipe) == -1)
+    die("pipe:");
+  fcntl(drw->fm.pipe[0], F_SETFD, FD_CLOEXEC);
+  fcntl(drw->fm.pipe[1], F_SETFD, FD_CLOEXEC);
+  fcntl(drw->fm.pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(drw->fm.pipe[1], F_SETFL, O_NONBLOCK);
+  pthread_mutex_init(&drw->fm.lock, NULL);
+  pthread_cond_init(&drw->fm.cond, NULL);
+
   return drw;
 }
 
@@ -71,17 +203,60 @@ drw_resize(Drw *drw, unsigned int w, unsigned int h)
 
   drw->w = w;
   drw->h = h;
+  /* whatever was pending belongs to the old pixmap */
+  drw->dl->nfills = drw->dl->ntexts = drw->dl->nglyphs = drw->dl->ncolors = 0;
+  if (drw->xftdraw)
+    XftDrawDestroy(drw->xftdraw);
+  drw->xftdraw = NULL;
   if (drw->drawable)
     XFreePixmap(drw->dpy, drw->drawable);
   drw->drawable = XCreatePixmap(drw->dpy, drw->root, w, h, DefaultDepth(drw->dpy, drw->screen));
 }
 
+static void
+fontjobs_free(FontJob *j)
+{
+  FontJob *next;
+
+  for (; j; j = next) {
+    next = j->next;
+    if (j->pattern)
+      FcPatternDestroy(j->pattern);
+    if (j->match)
+      FcPatternDestroy(j->match);
+    free(j);
+  }
+}
+
 void
 drw_free(Drw *drw)
 {
+  FontMatcher *fm = &drw->fm;
+
+  if (fm->started) {
+    pthread_mutex_lock(&fm->lock);
+    fm->quit = 1;
+    pthread_cond_signal(&fm->cond);
+    pthread_mutex_unlock(&fm->lock);
+    pthread_join(fm->thread, NULL);
+  }
+  fontjobs_free(fm->todo);
+  fontjobs_free(fm->done);
+  free(drw->warm);
+  close(fm->pipe[0]);
+  close(fm->pipe[1]);
+  pthread_mutex_destroy(&fm->lock);
+  pthread_cond_destroy(&fm->cond);
+  if (drw->xftdraw)
+    XftDrawDestroy(drw->xftdraw);
   XFreePixmap(drw->dpy, drw->drawable);
   XFreeGC(drw->dpy, drw->gc);
   drw_fontset_free(drw->fonts);
+  runcache_clear(drw->rc);
+  free(drw->rc);
+  free(drw->dl);
+  free(drw->fc->searched);
+  free(drw->fc);
   free(drw);
 }
 
@@ -94,6 +269,7 @@ xfont_create(Drw *drw, const char *fontname, FcPattern *fontpattern)
   Fnt *font;
   XftFont *xfont = NULL;
   FcPattern *pattern = NULL;
+  size_t i;
 
   if (fontname) {
     /* Using the pattern found at font->xfont->pattern does not yield the
@@ -124,10 +300,79 @@ xfont_create(Drw *drw, const char *fontname, FcPattern *fontpattern)
   font->pattern = pattern;
   font->h = xfont->ascent + xfont->descent;
   font->dpy = drw->dpy;
+  for (i = 0; i < LENGTH(font->ascii); i++)
+    font->ascii[i] = ADV_UNKNOWN;
 
   return font;
 }
 
+/* The length of the run of ASCII at the start of s. Whole vectors are
+ * read from aligned addresses: they never cross into the next page, so
+ * reading past the terminator is harmless. */
+static size_t
+asciirun(const char *s)
+{
+  const unsigned char *p = (const unsigned char *)s;
+#if defined(__SSE2__)
+  const unsigned char *b = p - ((uintptr_t)p & 15);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i v;
+  unsigned int stop;
+
+  /* bytes with the top bit set or 0 end the run */
+  v = _mm_load_si128((const __m128i *)b);
+  stop = _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+  stop &= ~0U << (p - b);
+  while (!stop) {
+    b += 16;
+    v = _mm_load_si128((const __m128i *)b);
+    stop = _mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero)));
+  }
+  return b + __builtin_ctz(stop) - p;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const unsigned char *b = p - ((uintptr_t)p & 15);
+  uint8x16_t v;
+  uint64_t stop;
+
+  /* 4 bits per byte: set for bytes with the top bit set or 0 */
+  v = vld1q_u8(b);
+  v = vorrq_u8(vcgeq_u8(v, vdupq_n_u8(0x80)), vceqzq_u8(v));
+  stop = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+  stop &= ~0ULL << 4 * (p - b);
+  while (!stop) {
+    b += 16;
+    v = vld1q_u8(b);
+    v = vorrq_u8(vcgeq_u8(v, vdupq_n_u8(0x80)), vceqzq_u8(v));
+    stop = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+  }
+  return b + __builtin_ctzll(stop) / 4 - p;
+#else
+  const unsigned char *q = p;
+
+  while (*q && *q < 0x80)
+    q++;
+  return q - p;
+#endif
+}
+
+/* the advance width of ASCII c in font, ADV_MISSING if it has no glyph */
+static int
+asciiadvance(Fnt *font, unsigned char c)
+{
+  XGlyphInfo ext;
+  FcChar32 ch = c;
+
+  if (font->ascii[c] == ADV_UNKNOWN) {
+    if (XftCharExists(font->dpy, font->xfont, ch)) {
+      XftTextExtents32(font->dpy, font->xfont, &ch, 1, &ext);
+      font->ascii[c] = ext.xOff;
+    } else {
+      font->ascii[c] = ADV_MISSING;
+    }
+  }
+  return font->ascii[c];
+}
+
 static void
 xfont_free(Fnt *font)
 {
@@ -139,6 +384,438 @@ xfont_free(Fnt *font)
   free(font);
 }
 
+/* forget every lookup and number the fonts of the current set */
+static void
+fontcache_reset(Drw *drw)
+{
+  FontCache *fc = drw->fc;
+  Fnt *f;
+  unsigned int i = 1, cap = fc->searchedcap;
+  void *searched = fc->searched;
+
+  memset(fc, 0, sizeof(FontCache));
+  fc->searched = searched;
+  fc->searchedcap = cap;
+  runcache_clear(drw->rc);
+  for (f = drw->fonts; f; f = f->next) {
+    f->slot = i < FONTCACHE_PENDING ? i : 0;
+    if (f->slot)
+      fc->slots[i++] = f;
+    fc->nfallbacks += f->isfallback;
+  }
+}
+
+static unsigned char *
+fontcache_entry(FontCache *fc, long cp)
+{
+  unsigned int h, i;
+
+  if (cp < 0x10000)
+    return &fc->bmp[cp];
+  for (i = 0; i < fc->nsearched; i++)
+    if (fc->searched[i].cp == cp)
+      return &fc->searched[i].slot;
+  h = ((unsigned int)cp * 2654435761U) % FONTCACHE_ASTRAL;
+  if (fc->astral[h].cp != cp) {
+    fc->astral[h].cp = cp;
+    fc->astral[h].slot = 0;
+  }
+  return &fc->astral[h].slot;
+}
+
+/* the entry of cp, one of the searched list if it is above the BMP */
+static unsigned char *
+fontcache_searched(FontCache *fc, long cp)
+{
+  unsigned int i;
+
+  if (cp < 0x10000)
+    return &fc->bmp[cp];
+  for (i = 0; i < fc->nsearched; i++)
+    if (fc->searched[i].cp == cp)
+      return &fc->searched[i].slot;
+  if (fc->nsearched == fc->searchedcap) {
+    fc->searchedcap = fc->searchedcap ? fc->searchedcap * 2 : 16;
+    if (!(fc->searched = realloc(fc->searched, fc->searchedcap * sizeof *fc->searched)))
+      die("realloc:");
+  }
+  fc->searched[fc->nsearched].cp = cp;
+  fc->searched[fc->nsearched].slot = 0;
+  return &fc->searched[fc->nsearched++].slot;
+}
+
+/* The first font of the set which has cp, or NULL. *nomatch tells whether
+ * fontconfig was already asked for it, in vain or still busy. */
+static Fnt *
+fontcache_get(Drw *drw, long cp, int *nomatch)
+{
+  FontCache *fc = drw->fc;
+  unsigned char *e = fontcache_entry(fc, cp);
+  Fnt *f;
+
+  *nomatch = *e == FONTCACHE_NOMATCH || *e == FONTCACHE_PENDING;
+  if (*nomatch)
+    return NULL;
+  if (!*e || !(f = fc->slots[*e])) {
+    for (f = drw->fonts; f; f = f->next)
+      if (XftCharExists(drw->dpy, f->xfont, cp))
+	break;
+    if (!f)
+      return NULL;
+    *e = f->slot;
+  }
+  f->lastused = fc->clock;
+  return f;
+}
+
+static void
+fontcache_evict(Drw *drw, Fnt *victim)
+{
+  FontCache *fc = drw->fc;
+  Fnt **fp;
+  size_t i;
+
+  for (fp = &drw->fonts; *fp && *fp != victim; fp = &(*fp)->next);
+  if (!*fp)
+    return;
+  *fp = victim->next;
+  if (victim->slot) {
+    for (i = 0; i < LENGTH(fc->bmp); i++)
+      if (fc->bmp[i] == victim->slot)
+	fc->bmp[i] = 0;
+    for (i = 0; i < LENGTH(fc->astral); i++)
+      if (fc->astral[i].slot == victim->slot)
+	fc->astral[i].slot = 0;
+    for (i = 0; i < fc->nsearched; i++)
+      if (fc->searched[i].slot == victim->slot)
+	fc->searched[i].slot = 0;
+    fc->slots[victim->slot] = NULL;
+  }
+  fc->nfallbacks--;
+  runcache_clear(drw->rc);
+  xfont_free(victim);
+}
+
+static int
+sameface(FcPattern *a, FcPattern *b)
+{
+  FcChar8 *fa, *fb;
+  int ia = 0, ib = 0;
+
+  if (FcPatternGetString(a, FC_FILE, 0, &fa) != FcResultMatch
+      || FcPatternGetString(b, FC_FILE, 0, &fb) != FcResultMatch)
+    return 0;
+  FcPatternGetInteger(a, FC_INDEX, 0, &ia);
+  FcPatternGetInteger(b, FC_INDEX, 0, &ib);
+  return ia == ib && !strcmp((char *)fa, (char *)fb);
+}
+
+/* Add the font matched by fontconfig to the end of the set, unless the
+ * same face is already loaded. Past FONTCACHE_FALLBACK fallbacks the least
+ * recently used one is dropped. Takes ownership of match. */
+static Fnt *
+fontcache_fallback(Drw *drw, FcPattern *match)
+{
+  FontCache *fc = drw->fc;
+  Fnt *f, *lru = NULL, *tail;
+  unsigned int slot;
+
+  for (f = drw->fonts; f; f = f->next)
+    if (sameface(match, f->xfont->pattern)) {
+      FcPatternDestroy(match);
+      return f;
+    }
+
+  for (f = drw->fonts; f; f = f->next)
+    if (f->isfallback && (!lru || f->lastused < lru->lastused))
+      lru = f;
+  if (lru && fc->nfallbacks >= FONTCACHE_FALLBACK)
+    fontcache_evict(drw, lru);
+
+  if (!(f = xfont_create(drw, NULL, match)))
+    return NULL;
+  f->isfallback = 1;
+  f->lastused = fc->clock;
+  for (slot = 1; slot < FONTCACHE_PENDING && fc->slots[slot]; slot++);
+  if (slot < FONTCACHE_PENDING) {
+    f->slot = slot;
+    fc->slots[slot] = f;
+  }
+  for (tail = drw->fonts; tail->next; tail = tail->next);
+  tail->next = f;
+  fc->nfallbacks++;
+  return f;
+}
+
+static unsigned int
+runhash(const char *text)
+{
+  unsigned int h = 2166136261u;
+
+  while (*text)
+    h = (h ^ (unsigned char)*text++) * 16777619u;
+  return h;
+}
+
+static GlyphRun *
+runcache_get(Drw *drw, const char *text, unsigned int hash)
+{
+  RunCache *rc = drw->rc;
+  unsigned int i;
+
+  for (i = 0; i < rc->n; i++) {
+    if (rc->hash[i] == hash && !strcmp(rc->runs[i].text, text)) {
+      rc->runs[i].lastused = ++rc->clock;
+      rc->hits++;
+      return &rc->runs[i];
+    }
+  }
+  rc->misses++;
+  return NULL;
+}
+
+/* Lay out text with the fonts drw_text() picked for it. Text with invalid
+ * UTF-8 or with codepoints still being searched for is left out. */
+static void
+runcache_put(Drw *drw, const char *text, unsigned int hash)
+{
+  RunCache *rc = drw->rc;
+  XftGlyphFontSpec specs[RUNCACHE_GLYPHS];
+  XGlyphInfo ext;
+  GlyphRun *r;
+  Fnt *f;
+  unsigned int i, n = 0, pen = 0;
+  size_t len;
+  long cp;
+  int clen, err, nomatch;
+
+  for (len = 0; text[len]; len += clen) {
+    clen = utf8decode(text + len, &cp, &err);
+    if (err || n == RUNCACHE_GLYPHS)
+      return;
+    if (!(f = fontcache_get(drw, cp, &nomatch))) {
+      if (!nomatch || *fontcache_entry(drw->fc, cp) == FONTCACHE_PENDING)
+	return;
+      f = drw->fonts;
+    }
+    specs[n].font = f->xfont;
+    specs[n].glyph = XftCharIndex(drw->dpy, f->xfont, cp);
+    specs[n].x = pen;
+    specs[n].y = 0;
+    XftGlyphExtents(drw->dpy, f->xfont, &specs[n].glyph, 1, &ext);
+    pen += ext.xOff;
+    n++;
+  }
+
+  if (rc->n < RUNCACHE_SIZE) {
+    r = &rc->runs[rc->n++];
+  } else {
+    for (r = rc->runs, i = 1; i < RUNCACHE_SIZE; i++)
+      if (rc->runs[i].lastused < r->lastused)
+	r = &rc->runs[i];
+    free(r->text);
+    free(r->specs);
+    rc->evictions++;
+  }
+  rc->hash[r - rc->runs] = hash;
+  r->text = ecalloc(len + 1, 1);
+  memcpy(r->text, text, len);
+  r->specs = ecalloc(n, sizeof(XftGlyphFontSpec));
+  memcpy(r->specs, specs, n * sizeof(XftGlyphFontSpec));
+  r->n = n;
+  r->w = pen;
+  r->lastused = ++rc->clock;
+}
+
+static void
+runcache_draw(Drw *drw, GlyphRun *r, int x, int y, unsigned int w, unsigned int h, XftColor *col)
+{
+  XftGlyphFontSpec specs[RUNCACHE_GLYPHS];
+  XftFont *f;
+  unsigned int i;
+
+  for (i = 0; i < r->n; i++) {
+    f = r->specs[i].font;
+    specs[i] = r->specs[i];
+    specs[i].x += x;
+    specs[i].y = y + (h - (f->ascent + f->descent)) / 2 + f->ascent;
+  }
+  drawlist_glyphs(drw, col, specs, r->n, x, y, w, h);
+}
+
+static void *
+fontmatcher_run(void *arg)
+{
+  FontMatcher *fm = arg;
+  FontJob *j;
+  FcResult result;
+
+  pthread_mutex_lock(&fm->lock);
+  while (!fm->quit) {
+    if (!(j = fm->todo)) {
+      pthread_cond_wait(&fm->cond, &fm->lock);
+      continue;
+    }
+    fm->todo = j->next;
+    pthread_mutex_unlock(&fm->lock);
+
+    FcConfigSubstitute(NULL, j->pattern, FcMatchPattern);
+    FcDefaultSubstitute(j->pattern);
+    j->match = FcFontMatch(NULL, j->pattern, &result);
+
+    pthread_mutex_lock(&fm->lock);
+    j->next = fm->done;
+    fm->done = j;
+    pthread_mutex_unlock(&fm->lock);
+    if (write(fm->pipe[1], "", 1) == -1) {
+      /* the pipe is full, a wakeup is pending anyway */
+    }
+    pthread_mutex_lock(&fm->lock);
+  }
+  pthread_mutex_unlock(&fm->lock);
+  return NULL;
+}
+
+/* Queue the search for a font that has cp. Until drw_fontset_collect()
+ * picks up the answer the codepoint is drawn with the first font. */
+static void
+fontmatcher_queue(Drw *drw, long cp)
+{
+  FontMatcher *fm = &drw->fm;
+  FcCharSet *fccharset;
+  FontJob *j;
+
+  if (!drw->fonts->pattern) {
+    /* Refer to the comment in xfont_create for more information. */
+    die("the first font in the cache must be loaded from a font string.");
+  }
+
+  j = ecalloc(1, sizeof(FontJob));
+  j->cp = cp;
+  fccharset = FcCharSetCreate();
+  FcCharSetAddChar(fccharset, cp);
+  j->pattern = FcPatternDuplicate(drw->fonts->pattern);
+  FcPatternAddCharSet(j->pattern, FC_CHARSET, fccharset);
+  FcPatternAddBool(j->pattern, FC_SCALABLE, FcTrue);
+  FcCharSetDestroy(fccharset);
+  /* what XftFontMatch() would add, it needs the display */
+  XftDefaultSubstitute(drw->dpy, drw->screen, j->pattern);
+
+  *fontcache_searched(drw->fc, cp) = FONTCACHE_PENDING;
+
+  pthread_mutex_lock(&fm->lock);
+  if (!fm->started) {
+    if (pthread_create(&fm->thread, NULL, fontmatcher_run, fm) != 0)
+      die("pthread_create:");
+    fm->started = 1;
+  }
+  j->next = fm->todo;
+  fm->todo = j;
+  pthread_cond_signal(&fm->cond);
+  pthread_mutex_unlock(&fm->lock);
+}
+
+int
+drw_fontset_fd(Drw *drw)
+{
+  return drw ? drw->fm.pipe[0] : -1;
+}
+
+/* Load the fonts found by the matcher thread. Returns the number of
+ * codepoints resolved, text drawn since their search started needs to be
+ * drawn again. */
+int
+drw_fontset_collect(Drw *drw)
+{
+  FontMatcher *fm = &drw->fm;
+  FontJob *jobs, *j;
+  unsigned char *e;
+  char buf[64];
+  Fnt *f;
+  int n = 0;
+
+  while (read(fm->pipe[0], buf, sizeof buf) > 0);
+  pthread_mutex_lock(&fm->lock);
+  jobs = fm->done;
+  fm->done = NULL;
+  pthread_mutex_unlock(&fm->lock);
+
+  for (j = jobs; j; j = j->next, n++) {
+    f = j->match ? fontcache_fallback(drw, j->match) : NULL;
+    j->match = NULL; /* owned by the font set now */
+    e = fontcache_entry(drw->fc, j->cp);
+    if (f && XftCharExists(drw->dpy, f->xfont, j->cp))
+      *e = 0; /* looked up again on the next draw */
+    else
+      *e = FONTCACHE_NOMATCH;
+  }
+  fontjobs_free(jobs);
+  return n;
+}
+
+/* Queue text to have its fonts looked up and its glyphs loaded ahead of
+ * the first drw_text() of it. The string must stay around until then. */
+void
+drw_prewarm(Drw *drw, const char *text)
+{
+  if (!drw || !text || !*text)
+    return;
+  if (drw->nwarm == drw->warmcap) {
+    drw->warmcap = drw->warmcap ? drw->warmcap * 2 : 64;
+    if (!(drw->warm = realloc(drw->warm, drw->warmcap * sizeof(char *))))
+      die("realloc:");
+  }
+  drw->warm[drw->nwarm++] = text;
+}
+
+static int
+textpending(Drw *drw, const char *text)
+{
+  long cp;
+  int len, err, nomatch;
+
+  for (; *text; text += len) {
+    len = utf8decode(text, &cp, &err);
+    if (!fontcache_get(drw, cp, &nomatch) && nomatch
+	&& *fontcache_entry(drw->fc, cp) == FONTCACHE_PENDING)
+      return 1;
+  }
+  return 0;
+}
+
+static unsigned long
+elapsedus(const struct timespec *t0)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (t.tv_sec - t0->tv_sec) * 1000000UL + (t.tv_nsec - t0->tv_nsec) / 1000;
+}
+
+/* Work through the drw_prewarm() queue for about budget_us. Measuring a
+ * string starts the fallback searches it needs and makes Xft rasterise
+ * its glyphs; strings waiting for a search are retried after the next
+ * drw_fontset_collect(). Returns whether anything can be done right away. */
+int
+drw_prewarm_step(Drw *drw, unsigned long budget_us)
+{
+  struct timespec t0;
+  unsigned int i = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  while (i < drw->nwarm) {
+    if (elapsedus(&t0) >= budget_us)
+      return 1;
+    if (!textpending(drw, drw->warm[i]))
+      drw_fontset_getwidth(drw, drw->warm[i]);
+    if (textpending(drw, drw->warm[i]))
+      i++;
+    else
+      drw->warm[i] = drw->warm[--drw->nwarm];
+  }
+  return 0;
+}
+
 Fnt*
 drw_fontset_create(Drw* drw, const char *fonts[], size_t fontcount)
 {
@@ -154,7 +831,9 @@ drw_fontset_create(Drw* drw, const char *fonts[], size_t fontcount)
       ret = cur;
     }
   }
-  return (drw->fonts = ret);
+  drw->fonts = ret;
+  fontcache_reset(drw);
+  return ret;
 }
 
 void
@@ -198,8 +877,10 @@ drw_scm_create(Drw *drw, const char *clrnames[], size_t clrcount)
 void
 drw_setfontset(Drw *drw, Fnt *set)
 {
-  if (drw)
+  if (drw) {
     drw->fonts = set;
+    fontcache_reset(drw);
+  }
 }
 
 void
@@ -214,30 +895,30 @@ drw_rect(Drw *drw, int x, int y, unsigned int w, unsigned int h, int filled, int
 {
   if (!drw || !drw->scheme)
     return;
-  XSetForeground(drw->dpy, drw->gc, invert ? drw->scheme[ColBg].pixel : drw->scheme[ColFg].pixel);
-  if (filled)
-    XFillRectangle(drw->dpy, drw->drawable, drw->gc, x, y, w, h);
-  else
+  if (filled) {
+    drawlist_fill(drw, invert ? drw->scheme[ColBg].pixel : drw->scheme[ColFg].pixel, x, y, w, h);
+  } else {
+    drawlist_flush(drw);
+    XSetForeground(drw->dpy, drw->gc, invert ? drw->scheme[ColBg].pixel : drw->scheme[ColFg].pixel);
     XDrawRectangle(drw->dpy, drw->drawable, drw->gc, x, y, w - 1, h - 1);
+  }
 }
 
 int
 drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lpad, const char *text, int invert)
 {
-  int ty, ellipsis_x = 0;
-  unsigned int tmpw, ew, ellipsis_w = 0, ellipsis_len, hash, h0, h1;
+  int ty, ellipsis_x = 0, nomatch = 0, adv;
+  unsigned int tmpw, ew, ellipsis_w = 0, ellipsis_len;
+  size_t i, run;
   XftDraw *d = NULL;
   Fnt *usedfont, *curfont, *nextfont;
+  GlyphRun *gr;
   int utf8strlen, utf8charlen, utf8err, render = x || y || w || h;
   long utf8codepoint = 0;
-  const char *utf8str;
-  FcCharSet *fccharset;
-  FcPattern *fcpattern;
-  FcPattern *match;
-  XftResult result;
+  unsigned int hash;
+  const char *utf8str, *start = text;
   int charexists = 0, overflow = 0;
-  /* keep track of a couple codepoints for which we have no match. */
-  static unsigned int nomatches[128], ellipsis_width, invalid_width;
+  static unsigned int ellipsis_width, invalid_width;
   static const char invalid[] = "�";
 
   if (!drw || (render && (!drw->scheme || !w)) || !text || !drw->fonts)
@@ -246,55 +927,88 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
   if (!render) {
     w = invert ? invert : ~invert;
   } else {
-    XSetForeground(drw->dpy, drw->gc, drw->scheme[invert ? ColFg : ColBg].pixel);
-    XFillRectangle(drw->dpy, drw->drawable, drw->gc, x, y, w, h);
+    drawlist_fill(drw, drw->scheme[invert ? ColFg : ColBg].pixel, x, y, w, h);
     if (w < lpad) return x + w;
-    d = XftDrawCreate(drw->dpy, drw->drawable,
-		      DefaultVisual(drw->dpy, drw->screen),
-		      DefaultColormap(drw->dpy, drw->screen));
+    d = xftdraw(drw);
     x += lpad;
     w -= lpad;
   }
 
   usedfont = drw->fonts;
+  drw->fc->clock++;
   if (!ellipsis_width && render)
     ellipsis_width = drw_fontset_getwidth(drw, "...");
   if (!invalid_width && render)
     invalid_width = drw_fontset_getwidth(drw, invalid);
+
+  /* text laid out before is drawn without decoding it, unless it has to
+   * be cut short */
+  hash = runhash(text);
+  if ((gr = runcache_get(drw, text, hash)) && gr->w <= w) {
+    if (render)
+      runcache_draw(drw, gr, x, y, w, h, &drw->scheme[invert ? ColBg : ColFg]);
+    return x + (render ? w : gr->w);
+  }
+
   while (1) {
     ew = ellipsis_len = utf8err = utf8charlen = utf8strlen = 0;
     utf8str = text;
     nextfont = NULL;
     while (*text) {
-      utf8charlen = utf8decode(text, &utf8codepoint, &utf8err);
-      for (curfont = drw->fonts; curfont; curfont = curfont->next) {
-	charexists = charexists || XftCharExists(drw->dpy, curfont->xfont, utf8codepoint);
-	if (charexists) {
-	  drw_font_getexts(curfont, text, utf8charlen, &tmpw, NULL);
+      /* The first font draws the ASCII it has, so such runs are measured
+       * from its advance table without decoding. */
+      if (usedfont == drw->fonts && !charexists && (run = asciirun(text))) {
+	for (i = 0; i < run && (adv = asciiadvance(usedfont, text[i])) >= 0; i++) {
 	  if (ew + ellipsis_width <= w) {
-	    /* keep track where the ellipsis still fits */
 	    ellipsis_x = x + ew;
 	    ellipsis_w = w - ew;
 	    ellipsis_len = utf8strlen;
 	  }
-
-	  if (ew + tmpw > w) {
+	  if (ew + adv > w) {
 	    overflow = 1;
-	    /* called from drw_fontset_getwidth_clamp():
-	     * it wants the width AFTER the overflow
-	     */
 	    if (!render)
-	      x += tmpw;
+	      x += adv;
 	    else
 	      utf8strlen = ellipsis_len;
-	  } else if (curfont == usedfont) {
-	    text += utf8charlen;
-	    utf8strlen += utf8err ? 0 : utf8charlen;
-	    ew += utf8err ? 0 : tmpw;
-	  } else {
-	    nextfont = curfont;
+	    break;
 	  }
+	  utf8strlen++;
+	  ew += adv;
+	}
+	text += i;
+	if (overflow)
 	  break;
+	if (i == run)
+	  continue;
+      }
+      utf8charlen = utf8decode(text, &utf8codepoint, &utf8err);
+      /* after a failed fallback search the first font draws the char */
+      curfont = charexists ? drw->fonts : fontcache_get(drw, utf8codepoint, &nomatch);
+      if (curfont) {
+	charexists = 1;
+	drw_font_getexts(curfont, text, utf8charlen, &tmpw, NULL);
+	if (ew + ellipsis_width <= w) {
+	  /* keep track where the ellipsis still fits */
+	  ellipsis_x = x + ew;
+	  ellipsis_w = w - ew;
+	  ellipsis_len = utf8strlen;
+	}
+
+	if (ew + tmpw > w) {
+	  overflow = 1;
+	  /* called from drw_fontset_getwidth_clamp():
+	   * it wants the width AFTER the overflow
+	   */
+	  if (!render)
+	    x += tmpw;
+	  else
+	    utf8strlen = ellipsis_len;
+	} else if (curfont == usedfont) {
+	  text += utf8charlen;
+	  utf8strlen += utf8err ? 0 : utf8charlen;
+	  ew += utf8err ? 0 : tmpw;
+	} else {
+	  nextfont = curfont;
 	}
       }
 
@@ -307,6 +1021,7 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
     if (utf8strlen) {
       if (render) {
 	ty = y + (h - usedfont->h) / 2 + usedfont->xfont->ascent;
+	drawlist_flush(drw);
 	XftDrawStringUtf8(d, &drw->scheme[invert ? ColBg : ColFg],
 			  usedfont->xfont, x, ty, (XftChar8 *)utf8str, utf8strlen);
       }
@@ -332,51 +1047,16 @@ drw_text(Drw *drw, int x, int y, unsigned int w, unsigned int h, unsigned int lp
        * character must be drawn. */
       charexists = 1;
 
-      hash = (unsigned int)utf8codepoint;
-      hash = ((hash >> 16) ^ hash) * 0x21F0AAAD;
-      hash = ((hash >> 15) ^ hash) * 0xD35A2D97;
-      h0 = ((hash >> 15) ^ hash) % LENGTH(nomatches);
-      h1 = (hash >> 17) % LENGTH(nomatches);
-      /* avoid expensive XftFontMatch call when we know we won't find a match */
-      if (nomatches[h0] == utf8codepoint || nomatches[h1] == utf8codepoint)
-	goto no_match;
-
-      fccharset = FcCharSetCreate();
-      FcCharSetAddChar(fccharset, utf8codepoint);
-
-      if (!drw->fonts->pattern) {
-	/* Refer to the comment in xfont_create for more information. */
-	die("the first font in the cache must be loaded from a font string.");
-      }
-
-      fcpattern = FcPatternDuplicate(drw->fonts->pattern);
-      FcPatternAddCharSet(fcpattern, FC_CHARSET, fccharset);
-      FcPatternAddBool(fcpattern, FC_SCALABLE, FcTrue);
-
-      FcConfigSubstitute(NULL, fcpattern, FcMatchPattern);
-      FcDefaultSubstitute(fcpattern);
-      match = XftFontMatch(drw->dpy, drw->screen, fcpattern, &result);
-
-      FcCharSetDestroy(fccharset);
-      FcPatternDestroy(fcpattern);
-
-      if (match) {
-	usedfont = xfont_create(drw, NULL, match);
-	if (usedfont && XftCharExists(drw->dpy, usedfont->xfont, utf8codepoint)) {
-	  for (curfont = drw->fonts; curfont->next; curfont = curfont->next)
-	    ; /* NOP */
-	  curfont->next = usedfont;
-	} else {
-	  xfont_free(usedfont);
-	  nomatches[nomatches[h0] ? h1 : h0] = utf8codepoint;
-	no_match:
-	  usedfont = drw->fonts;
-	}
-      }
+      /* Until a fallback font turns up, if ever, the first font draws
+       * it. The search runs on the matcher thread and the caller gets to
+       * redraw once drw_fontset_collect() has loaded the result. */
+      if (!nomatch)
+	fontmatcher_queue(drw, utf8codepoint);
+      usedfont = drw->fonts;
     }
   }
-  if (d)
-    XftDrawDestroy(d);
+  if (!gr && !overflow)
+    runcache_put(drw, start, hash);
 
   return x + (render ? w : 0);
 }
@@ -387,6 +1067,7 @@ drw_map(Drw *drw, Window win, int x, int y, unsigned int w, unsigned int h)
   if (!drw)
     return;
 
+  drawlist_flush(drw);
   XCopyArea(drw->dpy, drw->drawable, win, drw->gc, x, y, w, h, x, y);
   XSync(drw->dpy, False);
 }
@@ -10,8 +10,103 @@ typedef struct Fnt {
   XftFont *xfont;
   FcPattern *pattern;
   struct Fnt *next;
+  unsigned char slot;      /* index in FontCache.slots, 0 if none */
+  int isfallback;          /* found by fontconfig for a missing glyph */
+  unsigned long lastused;  /* FontCache.clock when last picked */
+  short ascii[128];        /* advance widths, filled in on first use */
 } Fnt;
 
+#define FONTCACHE_NOMATCH  0xFF  /* no font has the codepoint */
+#define FONTCACHE_PENDING  0xFE  /* fontconfig is still looking for one */
+#define FONTCACHE_ASTRAL   1024  /* entries of the codepoints above the BMP */
+#define FONTCACHE_FALLBACK 8     /* max number of fallback fonts kept */
+
+/* Which font of the set draws a codepoint: a slot per BMP codepoint and a
+ * direct-mapped hash for the rest. 0 means not looked up yet. Codepoints
+ * above the BMP that fontconfig was asked for are kept by exact value in
+ * a list instead, so that a hash collision cannot forget a search and
+ * start it again. */
+typedef struct {
+  unsigned char bmp[0x10000];
+  struct {
+    long cp;
+    unsigned char slot;
+  } astral[FONTCACHE_ASTRAL];
+  struct {
+    long cp;
+    unsigned char slot;
+  } *searched;
+  unsigned int nsearched, searchedcap;
+  Fnt *slots[FONTCACHE_PENDING];
+  unsigned int nfallbacks;
+  unsigned long clock;
+} FontCache;
+
+#define RUNCACHE_SIZE   128  /* glyph runs kept */
+#define RUNCACHE_GLYPHS 128  /* longer strings are not cached */
+
+/* A string laid out with the current font set: the font and glyph of
+ * each character, x relative to the start of the run. */
+typedef struct {
+  char *text;
+  unsigned int w, n;
+  XftGlyphFontSpec *specs;
+  unsigned long lastused;
+} GlyphRun;
+
+/* Runs are found by the hash of their text and dropped least recently
+ * used first. They only ever hold fully resolved text and are all
+ * forgotten when the font set changes. */
+typedef struct {
+  unsigned int hash[RUNCACHE_SIZE];
+  GlyphRun runs[RUNCACHE_SIZE];
+  unsigned int n;
+  unsigned long clock;
+  unsigned long hits, misses, evictions;
+} RunCache;
+
+#define DRAWLIST_FILLS  256
+#define DRAWLIST_TEXTS  64
+#define DRAWLIST_GLYPHS 1024
+#define DRAWLIST_COLORS 16
+
+/* What drw_rect() and drw_text() drew since the last flush. Fills are
+ * sent grouped by pixel with XFillRectangles, glyphs grouped by color
+ * with XftDrawGlyphFontSpec, fills before glyphs. A fill over pending
+ * text or over a pending fill of another pixel flushes first, so the
+ * result is the same as drawing in order. */
+typedef struct {
+  struct {
+    unsigned long pixel;
+    XRectangle r;
+  } fills[DRAWLIST_FILLS];
+  XRectangle texts[DRAWLIST_TEXTS]; /* areas of the pending glyphs */
+  XftGlyphFontSpec glyphs[DRAWLIST_GLYPHS];
+  unsigned char glyphcolor[DRAWLIST_GLYPHS];
+  XftColor colors[DRAWLIST_COLORS];
+  unsigned int nfills, ntexts, nglyphs, ncolors;
+} DrawList;
+
+/* a fallback font search handed to the FontMatcher thread */
+typedef struct FontJob {
+  long cp;
+  FcPattern *pattern;
+  FcPattern *match;
+  struct FontJob *next;
+} FontJob;
+
+/* Fallback font matching can take tens of milliseconds with large font
+ * collections, so it runs on a thread of its own. A byte on the pipe
+ * tells the event loop that drw_fontset_collect() has work. */
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  int started, quit;
+  int pipe[2];
+  FontJob *todo, *done;
+} FontMatcher;
+
 enum { ColFg, ColBg, ColBorder }; /* Clr scheme index */
 typedef XftColor Clr;
 
@@ -21,9 +116,16 @@ typedef struct {
   int screen;
   Window root;
   Drawable drawable;
+  XftDraw *xftdraw; /* of drawable, created on first use */
   GC gc;
   Clr *scheme;
   Fnt *fonts;
+  FontCache *fc;
+  RunCache *rc;
+  DrawList *dl;
+  FontMatcher fm;
+  const char **warm; /* strings waiting for drw_prewarm_step() */
+  unsigned int nwarm, warmcap;
 } Drw;
 
 /* Drawable abstraction */
@@ -34,6 +136,10 @@ void drw_free(Drw *drw);
 /* Fnt abstraction */
 Fnt *drw_fontset_create(Drw* drw, const char *fonts[], size_t fontcount);
 void drw_fontset_free(Fnt* set);
+int drw_fontset_fd(Drw *drw);
+int drw_fontset_collect(Drw *drw);
+void drw_prewarm(Drw *drw, const char *text);
+int drw_prewarm_step(Drw *drw, unsigned long budget_us);
 unsigned int drw_fontset_getwidth(Drw *drw, const char *text);
 unsigned int drw_fontset_getwidth_clamp(Drw *drw, const char *text, unsigned int n);
 void drw_font_getexts(Fnt *font, const char *text, unsigned int len, unsigned int *w, unsigned int *h);
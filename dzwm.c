@@ -11,19 +11,25 @@
  * in O(1) time.
  *
  * Each child of the root window is called a client, except windows which have
- * set the override_redirect flag. Clients are organized in a linked client
- * list on each monitor, the focus history is remembered through a stack list
- * on each monitor. Each client contains a bit array to indicate the tags of a
- * client.
+ * set the override_redirect flag. Clients are organized in a doubly linked
+ * client list on each monitor, the focus history is remembered through a
+ * doubly linked stack list on each monitor. In both lists the prev pointer of
+ * the head points to the tail, so unlinking, swapping and reverse walks are
+ * O(1) per step. Each client belongs to a workspace and a pane of it.
  *
  * Keys and tagging rules are organized as arrays and defined in config.h.
  *
  * To understand everything else, start reading main().
  */
+#define _GNU_SOURCE /* POSIX_SPAWN_SETSID */
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
+#include <poll.h>
 #include <pthread.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,7 +37,10 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
@@ -39,18 +48,26 @@
 #include <X11/Xlib.h>
 #include <X11/Xproto.h>
 #include <X11/Xutil.h>
+#include <X11/extensions/sync.h>
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif /* XINERAMA */
 #include <X11/Xft/Xft.h>
 
 #include "drw.h"
+#include "shmstatus.h"
+#include "sysinfo.h"
+#include "tz.h"
 #include "util.h"
 
 #define WM_MY_NAME "dzwm"
 
 /* macros */
 #define BUTTONMASK              (ButtonPressMask|ButtonReleaseMask)
+#define CLIENTMASK              (EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask)
+#define ROOTMASK                (SubstructureRedirectMask|SubstructureNotifyMask \
+				 |ButtonPressMask|EnterWindowMask \
+				 |LeaveWindowMask|StructureNotifyMask|PropertyChangeMask)
 #define CLEANMASK(mask)         (mask & ~(numlockmask|LockMask) & (ShiftMask|ControlMask|Mod1Mask|Mod2Mask|Mod3Mask|Mod4Mask|Mod5Mask))
 #define INTERSECT(x,y,w,h,m)    (MAX(0, MIN((x)+(w),(m)->wx+(m)->ww) - MAX((x),(m)->wx)) \
 				 * MAX(0, MIN((y)+(h),(m)->wy+(m)->wh) - MAX((y),(m)->wy)))
@@ -67,6 +84,18 @@
 #define BAR_STATUS_WIN_TITLE    0
 #define BAR_STATUS_WORKSPACES   1
 #define BAR_STATUS_CUSTOM       2
+#define STATUS_SEGS             16  /* segments per status module */
+#define STATUS_DRAWN            64  /* segments per bar kept for redraws */
+#define IPC_CLIENTS             16
+#define IPC_LINE                1024
+#define IPC_OUTBUF              16384 /* events queued for a subscriber */
+#define LAUNCHES                16  /* spawns remembered for placing their windows */
+#define POOL_MAX                8   /* instances of poolcmds kept at most */
+#ifdef POSIX_SPAWN_SETSID
+#define SPAWN_SETSID            POSIX_SPAWN_SETSID
+#else
+#define SPAWN_SETSID            POSIX_SPAWN_SETPGROUP /* a process group of its own at least */
+#endif
 
 typedef unsigned int uint;
 
@@ -97,11 +126,19 @@ enum { /* color schemes */
   SchemeDate4,
 };
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
-       NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
+       NetWMFullscreen, NetWMHidden, NetActiveWindow, NetWMWindowType,
+       NetWMWindowTypeDialog, NetClientList, NetClientListStacking, NetWMPid,
+       NetNumberOfDesktops, NetCurrentDesktop, NetDesktopNames, NetWMDesktop,
+       NetWorkarea, NetWMSyncRequest, NetWMSyncRequestCounter, NetStartupId,
+       NetLast }; /* EWMH atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
 enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
+enum { PendArrange = 1, PendBar = 2, PendStatus = 4, PendRestack = 8,
+       PendFocus = 16 }; /* deferred work */
+enum { IpcNone, IpcInt, IpcUint, IpcWs, IpcCmd }; /* ipc argument types */
+enum { EvWorkspace, EvPane, EvLayout, EvFocus, EvTitle, EvUrgent,
+       EvAdd, EvRemove, EvLast }; /* events of subscribe */
 
 #define SCHEME_MAX SchemeDate4
 
@@ -138,8 +175,14 @@ struct Client {
   int isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, ismaximized;
   int origx, origy, origw, origh;
   int is_arranged;
-  Client *next;
-  Client *snext;
+  int ishidden;          /* moved off-screen by showhide() */
+  int canfreeze, isfrozen;
+  pid_t pid;             /* _NET_WM_PID, 0 if unknown */
+  uint desktop;          /* _NET_WM_DESKTOP as last written, plus one */
+  uint64_t hiddensince;  /* nowus() when showhide() hid it */
+  Client *next, *prev;   /* prev of the list head is the tail */
+  Client *snext, *sprev; /* sprev of the stack head is the stack tail */
+  Client *wsnext, *wsprev; /* unordered list of the clients on ws_idx */
   Monitor *mon;
   Window win;
 };
@@ -151,6 +194,22 @@ typedef struct {
   const Arg arg;
 } Key;
 
+typedef struct {
+  const char *name;
+  void (*func)(const Arg *);
+  int type;
+} IpcCommand;
+
+typedef struct {
+  int fd;
+  char buf[IPC_LINE];
+  size_t len;
+  uint events;          /* 1 << Ev* subscribed to, 0 for commands */
+  char out[IPC_OUTBUF]; /* events not sent yet */
+  size_t outlen;
+  unsigned long dropped; /* events that did not fit in out since the last report */
+} IpcClient;
+
 typedef struct Rect Rect;
 typedef struct {
   const char *symbol;
@@ -164,25 +223,89 @@ struct Rect {
   uint h;
 };
 
+/* a piece of status text, padded by lpad and rpad pixels */
+typedef struct {
+  int scheme;
+  int lpad, rpad;
+  char text[256];
+} Segment;
+
+typedef struct {
+  Segment seg;
+  uint x, y, w, h;
+} DrawnSegment;
+
 typedef void (*BarStatusRender)(Monitor *m);
+typedef uint (*BarStatusUpdate)(Segment *segs, uint n);
+
+/* a process tree stopped by freezeclients() */
+typedef struct Freezer Freezer;
+struct Freezer {
+  pid_t pid;
+  char cgfreeze[320];   /* cgroup.freeze of its cgroup, empty if signalled */
+  pid_t *tree;          /* pid and its descendants */
+  size_t ntree;
+  Freezer *next;
+};
+
+/* a command started by spawn(), whose windows go where it was started */
+typedef struct {
+  pid_t pid;             /* 0 for a free slot */
+  char id[64];           /* the DESKTOP_STARTUP_ID it was given */
+  Monitor *mon;
+  uint ws_idx, pane_idx;
+  uint64_t started;      /* nowus() at spawn() */
+  int mapped;            /* one of its windows has been managed */
+  Window win;            /* that window until it is mapped, see mapnotify() */
+} Launch;
+
+/* A command kept started ahead of time, see pooltick(). maxrss is in
+ * KiB, 0 for no limit. */
+typedef struct {
+  const char **cmd;
+  uint size;
+  uint maxrss;
+} PoolCmd;
 
+/* an instance of a PoolCmd waiting to be taken */
+typedef struct {
+  pid_t pid;             /* 0 for a free slot */
+  const PoolCmd *pc;
+  char id[64];           /* the DESKTOP_STARTUP_ID it was given */
+  Window win;            /* None until it asks for its window to be mapped */
+} Pooled;
+
+/* A status module either draws itself on the main thread (render) or has
+ * its segments produced by the status thread (update), which refreshes
+ * them every interval milliseconds whether they are shown or not. Pinned
+ * modules are shown next to the selected one, each in at most maxw
+ * pixels when maxw is set. */
 typedef struct {
   const char *icon;
   BarStatusRender render;
+  BarStatusUpdate update;
   uint interval;
+  uint maxw;
+  int pinned;
 } StatusRenderSpec;
 
+typedef struct {
+  Segment segs[STATUS_SEGS];
+  uint n;
+  int dirty;            /* changed since the bars last showed it */
+  uint64_t due;         /* CLOCK_MONOTONIC µs of the next run */
+} StatusBuf;
+
 /* function declarations */
 static int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact);
 static void arrange(Monitor *m);
 static void arrangemon(Monitor *m);
 static void attach(Client *c);
+static void attachbefore(Client *c, Client *at);
 static void attachstack(Client *c);
-static void barstatus_command(Monitor *m, const char *cmd);
-static void barstatus_datetime(Monitor *m, char *label, char *tz);
+static void attachws(Client *c);
 static void barstatus_dummy(Monitor *m);
-static void barstatus_file(Monitor *m, const char *path);
-static void barstatus_read(Monitor *m, FILE *fp);
+static void barstatus_stats(Monitor *m);
 static void barstatus_wintitle(Monitor *m);
 static void barstatus_workspaces(Monitor *m);
 static void buttonpress(XEvent *e);
@@ -192,6 +315,7 @@ static void cleanup(void);
 static void cleanupmon(Monitor *mon);
 static void clearpanes(const Arg *arg);
 static void clientmessage(XEvent *e);
+static void compressmotion(XEvent *ev);
 static void configure(Client *c);
 static void configurenotify(XEvent *e);
 static void configurerequest(XEvent *e);
@@ -199,33 +323,60 @@ static Monitor *createmon(void);
 static void cycle_focus(const Arg *arg);
 static void cycle_layout(const Arg *arg);
 static void cycle_bar_status(const Arg *arg);
+static int deferred(Monitor *m, uint what);
 static void destroynotify(XEvent *e);
 static void detach(Client *c);
 static void detachstack(Client *c);
+static void detachws(Client *c);
 static void drawbar(Monitor *m);
 void drawbar_status(Monitor *m);
 static void drawbars(void);
+static int drawsegments(Monitor *m, Segment *segs, uint n);
+static int drawstatus(Monitor *m, uint i);
 static void enternotify(XEvent *e);
 static void expose(XEvent *e);
+static void fmtbytes(char *buf, size_t size, double bytes);
+static Launch *findlaunch(Window w, pid_t pid);
+static void flushdeferred(void);
 static void focus(Client *c);
 static void focusin(XEvent *e);
+static void focuswin(const Arg *arg);
 static void focuspane(const Arg *arg);
 static void focuspane_showing(const Arg *arg);
+static void freezeclients(void);
+static void freezepid(pid_t pid);
 static Atom getatomprop(Client *c, Atom prop);
+static pid_t getpidprop(Window w);
 static int getrootptr(int *x, int *y);
 static long getstate(Window w);
+static XSyncCounter getsynccounter(Client *c);
 static int gettextprop(Window w, Atom atom, char *text, unsigned int size);
 static void grabbuttons(Client *c, int focused);
+static int grabevent(XEvent *ev, int timeout);
 static void grabkeys(void);
+static void ignoreenter(void);
 static void inc_div_ratio(const Arg *arg);
 static void inc_max_disp(const Arg *arg);
+static void ipcaccept(void);
+static void ipccleanup(void);
+static void ipcdrop(IpcClient *ic);
+static void ipcevent(uint ev, const char *fmt, ...);
+static int ipcexec(char *cmd, char *err, size_t size);
+static void ipcflush(IpcClient *ic);
+static void ipcinit(void);
+static void ipcnotify(void);
+static int ipcqueue(IpcClient *ic, const char *ev, size_t len);
+static void ipcread(IpcClient *ic);
+static int ipcsubscribe(IpcClient *ic, char *names, char *err, size_t size);
+static Bool isgrabevent(Display *d, XEvent *ev, XPointer arg);
+static Bool ismotion(Display *d, XEvent *ev, XPointer arg);
 static void keypress(XEvent *e);
 static void killclient(const Arg *arg);
 static void manage(Window w, XWindowAttributes *wa);
+static void mapnotify(XEvent *e);
 static void mappingnotify(XEvent *e);
 static void maprequest(XEvent *e);
 static void maximize(const Arg *arg);
-static void motionnotify(XEvent *e);
 static void moveclient_pane(const Arg *arg);
 static void moveclient_paneidx(const Arg *arg);
 static void moveclient_ws(const Arg *arg);
@@ -233,7 +384,14 @@ void moveclient(Client *, int x, int y, int w, int c);
 static void movemouse(const Arg *arg);
 static void movestack(const Arg *arg);
 static Client *nexttiled(Client *c, uint pi);
+static uint64_t nowus(void);
+static void pin_bar_status(const Arg *arg);
+static void prewarmbar(void);
+static Client *prevtiled(Client *c, uint pi);
 static void pop(Client *c);
+static Window pooladopt(const char **cmd);
+static int poolhold(Window w);
+static void pooltick(void);
 static void propertynotify(XEvent *e);
 static void quit(const Arg *arg);
 static Monitor *recttomon(int x, int y, int w, int h);
@@ -241,19 +399,52 @@ static void resize(Client *c, int x, int y, int w, int h, int interact);
 static void resizeclient(Client *c, int x, int y, int w, int h);
 static void resizemouse(const Arg *arg);
 static void restack(Monitor *m);
+static int restorelayout(Monitor *m);
 static void run(void);
 static void scan(void);
+static int samesegment(const Segment *a, const Segment *b);
+static void savelayout(Monitor *m);
 static int sendevent(Client *c, Atom proto);
 static void sendmon(Client *c, Monitor *m);
 static void setclientstate(Client *c, long state);
 static void setfocus(Client *c);
 static void setfullscreen(Client *c, int fullscreen);
+static void seticonic(Client *c, int iconic);
+static void setsegment(Segment *s, int scheme, const char *fmt, ...);
 static void setup(void);
 static void seturgent(Client *c, int urg);
 static void set_bar_status(const Arg *arg);
+static void *shmwatcher(void *arg);
 static void showhide(Client *c);
+static void showhidemon(Monitor *m);
+static void showhidews(Monitor *m, uint ws_idx);
 static void spawn(const Arg *arg);
+static pid_t spawncmd(char **argv, const char *id);
+static uint status_battery(Segment *segs, uint n);
+static uint status_command(Segment *segs, uint n, const char *cmd);
+static uint status_cpu(Segment *segs, uint n);
+static uint status_datetime(Segment *segs, uint n, const char *label, const char *tz);
+static uint status_disk(Segment *segs, uint n);
+static uint status_file(Segment *segs, uint n, const char *path);
+static uint status_load(Segment *segs, uint n);
+static uint status_mem(Segment *segs, uint n);
+static uint status_net(Segment *segs, uint n);
+static uint status_read(Segment *segs, uint n, FILE *fp);
+static uint status_shm(Segment *segs, uint n, uint slot);
+static uint status_thermal(Segment *segs, uint n);
+static void statuscleanup(void);
+static uint64_t statusdue(uint64_t due, uint interval, uint64_t now);
+static void statusinit(void);
+static int statusshown(Monitor *m, uint i);
+static void statustick(void);
+static int statustimeout(void);
+static void statusupdated(void);
+static void *statusworker(void *arg);
+static void swapclients(Client *a, Client *b);
 static void switchworkspace(const Arg *arg);
+static void syncrequest(Client *c, XSyncAlarm alarm, XSyncValue *v, Time t);
+static uint takerepeats(XKeyEvent *ev);
+static void thawpid(pid_t pid);
 static void tile_v(Monitor *m, uint pi, Rect *r);
 static void tile_h(Monitor *m, uint pi, Rect *r);
 static void togglebar(const Arg *arg);
@@ -265,7 +456,10 @@ static void unmapnotify(XEvent *e);
 static void updatebarpos(Monitor *m);
 static void updatebars(void);
 static void updateclientlist(void);
+static void updatedesktops(void);
+static void updateedges(void);
 static int updategeom(void);
+static void updatenetwmstate(Client *c);
 static void updatenumlockmask(void);
 static void updatesizehints(Client *c);
 static void updatestatus(void);
@@ -297,9 +491,9 @@ static void (*handler[LASTEvent]) (XEvent *) = {
   [Expose] = expose,
   [FocusIn] = focusin,
   [KeyPress] = keypress,
+  [MapNotify] = mapnotify,
   [MappingNotify] = mappingnotify,
   [MapRequest] = maprequest,
-  [MotionNotify] = motionnotify,
   [PropertyNotify] = propertynotify,
   [UnmapNotify] = unmapnotify
 };
@@ -310,7 +504,31 @@ static Clr **scheme;
 static Display *dpy;
 static Drw *drw;
 static Monitor *mons, *selmon;
+static Monitor *statusmon; /* whose status the drawable holds */
 static Window root, wmcheckwin;
+static Freezer *freezers;
+static int havesync, syncevbase, syncerrbase; /* the XSync extension, for resize pacing */
+static unsigned long enterserial; /* see ignoreenter() */
+static struct {
+  uint frozen;          /* process trees currently frozen */
+  uint thaws;
+  uint64_t thaw_last_us, thaw_max_us;
+  unsigned long wakeups; /* returns from poll() in run() */
+  uint64_t map_last_us, map_max_us; /* from spawn() to the map of the first window */
+  uint maps;             /* launches seen mapped */
+  uint adopted;          /* spawns served from the pool */
+} stats;
+static Window adoptwin;  /* the pooled window spawn() last took, until it is mapped */
+static uint64_t adoptstart;
+static Launch launches[LAUNCHES];
+static uint launchseq;
+/* what the root window's EWMH properties were last set to */
+static struct {
+  Window *clients, *stacking;
+  uint nclients, nstacking, cap;
+  long current;
+  long workarea[4];
+} ewmh;
 
 /* configuration, allows nested code to access above variables */
 #include "config.h"
@@ -326,10 +544,30 @@ typedef struct {
   uint layout_idx;
 } Pane;
 
+typedef struct {
+  Client *c;
+  Window win;
+  uint pane_idx;
+  int bw;
+  int x, y, w, h;
+} CachedGeom;
+
+/* the geometry arrangemon() last computed for a workspace, together with
+ * everything the tiling depends on */
+typedef struct {
+  int valid;
+  Pane panes[WS_PANES];
+  uint div_ratio;
+  int wx, wy, ww, wh;
+  CachedGeom *geoms;
+  uint n, cap;
+} LayoutCache;
+
 typedef struct {
   Pane panes[WS_PANES];
   uint selpane;
   uint div_ratio;
+  LayoutCache cache;
 } Workspace;
 
 struct Monitor {
@@ -347,13 +585,81 @@ struct Monitor {
   int topbar;
   uint status_idx;
   uint status_x;
+  int pinned[BAR_STATUS_CNT];
   uint dx, dy, dw, dh;  /* drawing info for status bar */
-  time_t last_status_render;
+  uint dmin;            /* left end of the module being drawn */
+  DrawnSegment drawn[STATUS_DRAWN]; /* what drawsegments left in the drawable */
+  uint ndrawn, nsegs;
+  uint pending;         /* Pend* work deferred to the end of a batch */
+  uint evws, evalt, evshowing, evlayout[WS_PANES]; /* as last told to subscribers */
   Client *clients;
+  Client *wsclients[WS_LEN];
   Client *sel;
   Client *stack;
   Monitor *next;
   Window barwin;
+  Window edgewins[4];   /* InputOnly strips, see updateedges() */
+};
+
+static StatusBuf statusbufs[BAR_STATUS_CNT];
+static uint64_t renderdue[BAR_STATUS_CNT]; /* next tick of timed renders */
+static uint64_t housekeepdue;
+static Pooled pool[POOL_MAX];
+static int poolover[LENGTH(poolcmds)]; /* not refilled until one is taken */
+static struct {
+  pthread_t thread;
+  pthread_mutex_t lock;  /* guards statusbufs[].segs, n and dirty */
+  pthread_cond_t cond;
+  int pipe[2];           /* a byte when statusbufs changed */
+  int quit;
+  int kick;              /* run the modules with no interval */
+  ShmStatus *shm;        /* frames of external producers */
+  pthread_t watcher;
+} statusthread;
+static int batching; /* defer arranging and drawing, see deferred() */
+static int ipcfd = -1;
+static char ipcpath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static IpcClient ipcclients[IPC_CLIENTS];
+static uint ipcsubs;  /* clients subscribed to events */
+static Window evsel;  /* the focus as last told to subscribers */
+static const char *evnames[EvLast] = {
+  [EvWorkspace] = "workspace", [EvPane] = "pane", [EvLayout] = "layout",
+  [EvFocus] = "focus", [EvTitle] = "title", [EvUrgent] = "urgent",
+  [EvAdd] = "add", [EvRemove] = "remove",
+};
+
+/* the actions a client of the socket can run, by name */
+static const IpcCommand ipccommands[] = {
+  { "centerwindow",       centerwindow,       IpcNone },
+  { "clearpanes",         clearpanes,         IpcNone },
+  { "cycle_bar_status",   cycle_bar_status,   IpcInt },
+  { "cycle_focus",        cycle_focus,        IpcInt },
+  { "cycle_layout",       cycle_layout,       IpcInt },
+  { "focuspane",          focuspane,          IpcInt },
+  { "focuspane_showing",  focuspane_showing,  IpcInt },
+  { "focuswin",           focuswin,           IpcUint },
+  { "inc_div_ratio",      inc_div_ratio,      IpcInt },
+  { "inc_max_disp",       inc_max_disp,       IpcInt },
+  { "killclient",         killclient,         IpcNone },
+  { "maximize",           maximize,           IpcNone },
+  { "moveclient_pane",    moveclient_pane,    IpcInt },
+  { "moveclient_paneidx", moveclient_paneidx, IpcUint },
+  { "moveclient_ws",      moveclient_ws,      IpcUint },
+  { "movestack",          movestack,          IpcInt },
+  { "pin_bar_status",     pin_bar_status,     IpcUint },
+  { "quit",               quit,               IpcNone },
+  { "set_bar_status",     set_bar_status,     IpcUint },
+  { "spawn",              spawn,              IpcCmd },
+  { "switchworkspace",    switchworkspace,    IpcWs },
+  { "togglebar",          togglebar,          IpcNone },
+  { "togglefloating",     togglefloating,     IpcNone },
+  { "togglepane",         togglepane,         IpcUint },
+  { "zoom",               zoom,               IpcNone },
+};
+
+/* key actions whose queued auto-repeats keypress() runs as one batch */
+static void (*const repeatfuncs[])(const Arg *) = {
+  cycle_focus, inc_div_ratio, inc_max_disp, movestack,
 };
 
 int
@@ -427,13 +733,15 @@ applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact)
 void
 arrange(Monitor *m)
 {
+  if (deferred(m, PendArrange))
+    return;
   if (m) {
-    showhide(m->stack);
+    showhidemon(m);
     arrangemon(m);
     restack(m);
   } else
     for (m = mons; m; m = m->next) {
-      showhide(m->stack);
+      showhidemon(m);
       arrangemon(m);
     }
 }
@@ -443,13 +751,14 @@ arrangemon(Monitor *m)
 {
   const Workspace *ws = m->selws;
 
+  if (restorelayout(m))
+    return;
+
   uint tiled_cnt[WS_PANES] = {0};
-  for (Client *c = m->clients; c; c = c->next) {
+  for (Client *c = m->wsclients[m->ws_idx]; c; c = c->wsnext) {
     c->is_arranged = 0;
 
-    if (c->isfloating
-	|| c->ws_idx != m->ws_idx
-	|| !ISSHOWING(m, c->pane_idx))
+    if (c->isfloating || !ISSHOWING(m, c->pane_idx))
       continue;
 
     tiled_cnt[c->pane_idx]++;
@@ -491,67 +800,56 @@ arrangemon(Monitor *m)
       layouts[ws->panes[i].layout_idx].arrange(m, i, &r);
     }
   }
+  savelayout(m);
 }
 
 void
 attach(Client *c)
 {
-  c->next = c->mon->clients;
+  Client *head = c->mon->clients;
+
+  c->next = head;
+  c->prev = head ? head->prev : c;
+  if (head)
+    head->prev = c;
   c->mon->clients = c;
 }
 
+/* insert c right before at, which must be in c->mon->clients */
 void
-attachstack(Client *c)
+attachbefore(Client *c, Client *at)
 {
-  c->snext = c->mon->stack;
-  c->mon->stack = c;
+  c->next = at;
+  c->prev = at->prev;
+  if (at == c->mon->clients)
+    c->mon->clients = c;
+  else
+    c->prev->next = c;
+  at->prev = c;
 }
 
 void
-barstatus_command(Monitor *m, const char *cmd)
+attachstack(Client *c)
 {
-  FILE *fp = popen(cmd, "r");
-  if (!fp) {
-    fprintf(stderr, "Error popen with: %s\n", cmd);
-    return;
-  }
+  Client *head = c->mon->stack;
 
-  barstatus_read(m, fp);
-  pclose(fp);
+  c->snext = head;
+  c->sprev = head ? head->sprev : c;
+  if (head)
+    head->sprev = c;
+  c->mon->stack = c;
 }
 
 void
-barstatus_datetime(Monitor *m, char *label, char *tz)
+attachws(Client *c)
 {
-  time_t now = time(NULL);
-  setenv("TZ", tz, 1);
-  struct tm *tm = localtime(&now);
+  Client **head = &c->mon->wsclients[c->ws_idx];
 
-  uint w;
-  char buf[20];
-
-  w = TEXTW(label);
-  drw_setscheme(drw, scheme[SchemeDate1]);
-  m->dx -= w;
-  drw_text(drw, m->dx, m->dy, w, m->dh, lrpad / 2, label, 0);
-
-  strftime(buf, sizeof(buf), "%T", tm);
-  w = TEXTW(buf);
-  drw_setscheme(drw, scheme[SchemeDate2]);
-  m->dx -= w;
-  drw_text(drw, m->dx, m->dy, w, m->dh, lrpad / 2, buf, 0);
-
-  strftime(buf, sizeof(buf), "%a", tm);
-  w = TEXTW(buf);
-  drw_setscheme(drw, scheme[SchemeDate3]);
-  m->dx -= w;
-  drw_text(drw, m->dx, m->dy, w, m->dh, lrpad / 2, buf, 0);
-
-  strftime(buf, sizeof(buf), "%F", tm);
-  w = TEXTW(buf);
-  drw_setscheme(drw, scheme[SchemeDate4]);
-  m->dx -= w;
-  drw_text(drw, m->dx, m->dy, w, m->dh, lrpad / 2, buf, 0);
+  c->wsprev = NULL;
+  c->wsnext = *head;
+  if (*head)
+    (*head)->wsprev = c;
+  *head = c;
 }
 
 void
@@ -560,44 +858,24 @@ barstatus_dummy(Monitor *m)
 }
 
 void
-barstatus_file(Monitor *m, const char *path)
-{
-  FILE *fp = fopen(path, "r");
-  if (!fp) {
-    fprintf(stderr, "Error fopen with: %s\n", path);
-    return;
-  }
-
-  barstatus_read(m, fp);
-  fclose(fp);
-}
-
-void
-barstatus_read(Monitor *m, FILE *fp)
+barstatus_stats(Monitor *m)
 {
-  uint w;
-  char buf[300], *p;
-  while (fgets(buf, sizeof buf, fp) != 0) {
-    p = strtok(buf, "\t");
-    if (p == NULL) continue;
-    long si = strtol(p, NULL, 10);
-    if (si < 0 || si > SCHEME_MAX) si = 0;
-
-    p = strtok(NULL, "\t");
-    if (p == NULL) continue;
-    long pad = strtol(p, NULL, 10);
-    if (pad < 0 || pad > 20) pad = 0;
-
-    p = strtok(NULL, "\n");
-    if (p == NULL) continue;
-
-    w = TEXTW_(p) + pad;
-    if (m->status_x + w > m->dx) break;
-
-    drw_setscheme(drw, scheme[si]);
-    m->dx -= w;
-    drw_text(drw, m->dx, m->dy, w, m->dh, 0, p, 0);
-  }
+  char buf[240];
+  snprintf(buf, sizeof buf, "frozen %u  thaw %u: %lluus / max %lluus  runs %lu/%lu/%lu  wake %lu"
+	   "  map %lluus / max %lluus  pooled %u",
+	   stats.frozen, stats.thaws,
+	   (unsigned long long)stats.thaw_last_us,
+	   (unsigned long long)stats.thaw_max_us,
+	   drw->rc->hits, drw->rc->misses, drw->rc->evictions, stats.wakeups,
+	   (unsigned long long)stats.map_last_us,
+	   (unsigned long long)stats.map_max_us, stats.adopted);
+
+  uint w = TEXTW(buf);
+  if (m->dmin + w > m->dx) return;
+
+  drw_setscheme(drw, scheme[SchemeStats]);
+  m->dx -= w;
+  drw_text(drw, m->dx, m->dy, w, m->dh, lrpad / 2, buf, 0);
 }
 
 void
@@ -634,7 +912,7 @@ barstatus_workspaces(Monitor *m)
       if (!occ[i]) continue;
 
       uint w = TEXTW(wsnames[i]);
-      if (m->status_x + w > m->dx) break;
+      if (m->dmin + w > m->dx) break;
 
       m->dx -= w;
       drw_text(drw, m->dx, m->dy, w, m->dh, lrpad / 2, wsnames[i], urg[i]);
@@ -704,7 +982,16 @@ cleanup(void)
   Monitor *m;
   size_t i;
 
+  statuscleanup();
+  ipccleanup();
+  for (i = 0; i < POOL_MAX; i++)
+    if (pool[i].pid)
+      kill(pool[i].pid, SIGTERM);
   for (m = mons; m; m = m->next) {
+    /* give iconified clients back to whoever manages them next */
+    for (Client *c = m->stack; c; c = c->snext)
+      if (c->ishidden && hideiconic)
+	XMapWindow(dpy, c->win);
     while (m->stack)
       unmanage(m->stack, 0);
   }
@@ -736,6 +1023,15 @@ cleanupmon(Monitor *mon)
   }
   XUnmapWindow(dpy, mon->barwin);
   XDestroyWindow(dpy, mon->barwin);
+  for (int i = 0; i < 4; i++)
+    if (mon->edgewins[i])
+      XDestroyWindow(dpy, mon->edgewins[i]);
+  for (int i = 0; i < LAUNCHES; i++)
+    if (launches[i].mon == mon)
+      launches[i].pid = 0;
+  for (int i = 0; i < WS_LEN; i++)
+    for (int j = 0; j < WS_ALTS; j++)
+      free(mon->workspaces[i][j].cache.geoms);
   free(mon);
 }
 
@@ -775,6 +1071,16 @@ clientmessage(XEvent *e)
   }
 }
 
+/* skip to the newest of the MotionNotify events queued before the next
+ * button event */
+void
+compressmotion(XEvent *ev)
+{
+  int stop = 0;
+
+  while (XCheckIfEvent(dpy, ev, ismotion, (XPointer)&stop));
+}
+
 void
 configure(Client *c)
 {
@@ -809,7 +1115,9 @@ configurenotify(XEvent *e)
     sh = ev->height;
     if (updategeom() || dirty) {
       drw_resize(drw, sw, bh);
+      statusmon = NULL;
       updatebars();
+      updateedges();
       for (m = mons; m; m = m->next) {
 	for (c = m->clients; c; c = c->next)
 	  if (c->isfullscreen)
@@ -899,6 +1207,8 @@ createmon(void)
   m->topbar = topbar;
   m->status_idx = 0;
   m->status_x = 0;
+  for (int i = 0; i < BAR_STATUS_CNT; i++)
+    m->pinned[i] = statusrenderspecs[i].pinned;
   return m;
 }
 
@@ -914,7 +1224,6 @@ cycle_bar_status(const Arg *arg)
     i = 0;
 
   selmon->status_idx = i;
-  selmon->last_status_render = 0;
   drawbar_status(selmon);
 }
 
@@ -928,7 +1237,7 @@ cycle_focus(const Arg *arg)
   if (!ISSHOWING(selmon, pi))
     return;
 
-  Client *c = NULL, *i;
+  Client *c = NULL;
 
   if (arg->i > 0) {
     for (c = selmon->sel->next; c; c = c->next)
@@ -939,13 +1248,10 @@ cycle_focus(const Arg *arg)
 	if (ISCURRENTWS(c) && c->pane_idx == pi)
 	  break;
   } else {
-    for (i = selmon->clients; i != selmon->sel; i = i->next)
-      if (ISCURRENTWS(i) && i->pane_idx == pi)
-	c = i;
-    if (!c)
-      for (i = i->next; i; i = i->next)
-	if (ISCURRENTWS(i) && i->pane_idx == pi)
-	  c = i;
+    /* prev is circular, so this wraps around to the tail */
+    for (c = selmon->sel->prev; c != selmon->sel; c = c->prev)
+      if (ISCURRENTWS(c) && c->pane_idx == pi)
+	break;
   }
 
   if (c && c != selmon->sel) {
@@ -977,32 +1283,67 @@ cycle_layout(const Arg *arg)
   arrange(selmon);
 }
 
+/* While batching, note that m (every monitor if NULL) needs what done
+ * and return 1; flushdeferred() does it once at the end of the batch. */
+int
+deferred(Monitor *m, uint what)
+{
+  if (!batching)
+    return 0;
+  if (m)
+    m->pending |= what;
+  else
+    for (m = mons; m; m = m->next)
+      m->pending |= what;
+  return 1;
+}
+
 void
 destroynotify(XEvent *e)
 {
   Client *c;
   XDestroyWindowEvent *ev = &e->xdestroywindow;
+  Pooled *p;
 
   if ((c = wintoclient(ev->window)))
     unmanage(c, 1);
+  else
+    for (p = pool; p < pool + POOL_MAX; p++)
+      if (p->pid && p->win == ev->window)
+	p->pid = 0;
 }
 
 void
 detach(Client *c)
 {
-  Client **tc;
+  Monitor *m = c->mon;
 
-  for (tc = &c->mon->clients; *tc && *tc != c; tc = &(*tc)->next);
-  *tc = c->next;
+  if (c == m->clients)
+    m->clients = c->next;
+  else
+    c->prev->next = c->next;
+  if (c->next)
+    c->next->prev = c->prev;
+  else if (m->clients)
+    m->clients->prev = c->prev;
+  c->next = c->prev = NULL;
 }
 
 void
 detachstack(Client *c)
 {
-  Client **tc, *t;
-
-  for (tc = &c->mon->stack; *tc && *tc != c; tc = &(*tc)->snext);
-  *tc = c->snext;
+  Monitor *m = c->mon;
+  Client *t;
+
+  if (c == m->stack)
+    m->stack = c->snext;
+  else
+    c->sprev->snext = c->snext;
+  if (c->snext)
+    c->snext->sprev = c->sprev;
+  else if (m->stack)
+    m->stack->sprev = c->sprev;
+  c->snext = c->sprev = NULL;
 
   if (c == c->mon->sel) {
     for (t = c->mon->stack; t && !ISVISIBLE(t); t = t->snext);
@@ -1010,10 +1351,22 @@ detachstack(Client *c)
   }
 }
 
+void
+detachws(Client *c)
+{
+  if (c->wsprev)
+    c->wsprev->wsnext = c->wsnext;
+  else
+    c->mon->wsclients[c->ws_idx] = c->wsnext;
+  if (c->wsnext)
+    c->wsnext->wsprev = c->wsprev;
+  c->wsnext = c->wsprev = NULL;
+}
+
 void
 drawbar(Monitor *m)
 {
-  if (!m->showbar) return;
+  if (!m->showbar || deferred(m, PendBar)) return;
 
   const Workspace *ws = m->selws;
 
@@ -1096,41 +1449,31 @@ drawbar(Monitor *m)
 void
 drawbar_status(Monitor *m)
 {
-  if (!m->showbar) return;
-
-  m->dx = m->wx + m->ww;
-  m->dy = 3;
-  m->dw = m->dx - m->status_x;
-  m->dh = bh - m->dy;
-
-  if (m->status_idx < LENGTH(statusrenderspecs)) {
-    const StatusRenderSpec *s = &statusrenderspecs[m->status_idx];
-
-    uint w = TEXTW_(s->icon) + 7;
-    if (m->status_x + w > m->dx) return;
+  const uint right = m->wx + m->ww;
 
-    m->dx -= w;
-    drw_setscheme(drw, scheme[SchemeBarInfo]);
-    drw_rect(drw, m->dx, 0, w, m->dh, 1, 1);
-    drw_text(drw, m->dx, m->dy, w, m->dh, 4, s->icon, 0);
-
-    uint orig_x = m->dx;
-    time_t now = time(NULL);
-    if (now < m->last_status_render + s->interval)
-      return;
+  if (!m->showbar || deferred(m, PendStatus)) return;
 
-    s->render(m);
+  /* segments drawn last time are only reused from our own render */
+  if (statusmon != m)
+    m->ndrawn = 0;
+  m->nsegs = 0;
+  m->dx = right;
 
-    if (m->dy)
-      drw_rect(drw, m->dx, 0, orig_x - m->dx, m->dy, 1, 1);
-    m->last_status_render = time(NULL);
-  }
+  /* pinned modules keep their place at the right end, the selected one
+   * goes left of them */
+  for (uint i = BAR_STATUS_CNT; i-- > 0; )
+    if (m->pinned[i] && i != m->status_idx && !drawstatus(m, i))
+      break;
+  if (m->status_idx < BAR_STATUS_CNT)
+    drawstatus(m, m->status_idx);
+  m->ndrawn = MIN(m->nsegs, LENGTH(m->drawn));
+  statusmon = m;
 
   if (m->status_x < m->dx) {
     drw_setscheme(drw, scheme[SchemeBarInfo]);
     drw_rect(drw, m->status_x, 0, m->dx - m->status_x, bh, 1, 1);
   }
-  drw_map(drw, m->barwin, m->status_x, 0, m->dw, bh);
+  drw_map(drw, m->barwin, m->status_x, 0, right - m->status_x, bh);
 }
 
 void
@@ -1140,6 +1483,81 @@ drawbars(void)
     drawbar(m);
 }
 
+/* Draw segs right to left from m->dx, the first one rightmost. Returns 0
+ * if they ran out of room. A segment the drawable still holds from the
+ * previous render, at the same place, is neither measured nor drawn. */
+int
+drawsegments(Monitor *m, Segment *segs, uint n)
+{
+  uint i, w;
+  DrawnSegment *d;
+
+  for (i = 0; i < n; i++, m->nsegs++) {
+    d = m->nsegs < LENGTH(m->drawn) ? &m->drawn[m->nsegs] : NULL;
+    if (d && m->nsegs < m->ndrawn && d->x + d->w == m->dx
+	&& d->y == m->dy && d->h == m->dh && samesegment(&d->seg, &segs[i])) {
+      if (m->dmin + d->w > m->dx)
+	return 0;
+      m->dx -= d->w;
+      continue;
+    }
+
+    w = TEXTW_(segs[i].text) + segs[i].lpad + segs[i].rpad;
+    if (m->dmin + w > m->dx)
+      return 0;
+
+    drw_setscheme(drw, scheme[segs[i].scheme]);
+    m->dx -= w;
+    drw_text(drw, m->dx, m->dy, w, m->dh, segs[i].lpad, segs[i].text, 0);
+    if (d) {
+      d->seg = segs[i];
+      d->x = m->dx;
+      d->y = m->dy;
+      d->w = w;
+      d->h = m->dh;
+    }
+  }
+  return 1;
+}
+
+/* Draw status module i left of m->dx: its icon, then what it shows,
+ * which is cut off at its width budget. Returns 0 if the icon did not
+ * fit. Update modules are drawn from their last result, nothing is
+ * sampled here. */
+int
+drawstatus(Monitor *m, uint i)
+{
+  const StatusRenderSpec *s = &statusrenderspecs[i];
+  Segment segs[STATUS_SEGS];
+  uint w = TEXTW_(s->icon) + 7, orig_x, n;
+
+  if (m->status_x + w > m->dx) return 0;
+
+  m->dy = 3;
+  m->dh = bh - m->dy;
+  m->dx -= w;
+  drw_setscheme(drw, scheme[SchemeBarInfo]);
+  drw_rect(drw, m->dx, 0, w, m->dh, 1, 1);
+  drw_text(drw, m->dx, m->dy, w, m->dh, 4, s->icon, 0);
+
+  orig_x = m->dx;
+  m->dmin = s->maxw && m->dx > m->status_x + s->maxw ? m->dx - s->maxw : m->status_x;
+  m->dw = m->dx - m->dmin;
+  if (s->update) {
+    pthread_mutex_lock(&statusthread.lock);
+    n = statusbufs[i].n;
+    memcpy(segs, statusbufs[i].segs, n * sizeof(Segment));
+    pthread_mutex_unlock(&statusthread.lock);
+    drawsegments(m, segs, n);
+  } else {
+    s->render(m);
+  }
+
+  if (m->dy)
+    drw_rect(drw, m->dx, 0, orig_x - m->dx, m->dy, 1, 1);
+  return 1;
+}
+
 void
 enternotify(XEvent *e)
 {
@@ -1147,6 +1565,8 @@ enternotify(XEvent *e)
   Monitor *m;
   XCrossingEvent *ev = &e->xcrossing;
 
+  if (ev->serial <= enterserial)
+    return;
   if ((ev->mode != NotifyNormal || ev->detail == NotifyInferior) && ev->window != root)
     return;
   c = wintoclient(ev->window);
@@ -1166,8 +1586,69 @@ expose(XEvent *e)
   XExposeEvent *ev = &e->xexpose;
 
   if (ev->count == 0 && (m = wintomon(ev->window)))
-    if (m->status_idx == BAR_STATUS_WIN_TITLE)
+    if (statusshown(m, BAR_STATUS_WIN_TITLE))
+      drawbar_status(m);
+}
+
+void
+fmtbytes(char *buf, size_t size, double bytes)
+{
+  static const char units[] = "BKMGTP";
+  uint i;
+
+  for (i = 0; bytes >= 1000 && i < LENGTH(units) - 2; i++)
+    bytes /= 1024;
+  snprintf(buf, size, bytes < 10 && i ? "%.1f%c" : "%.0f%c", bytes, units[i]);
+}
+
+/* The launch a new window w of process pid comes from, by its
+ * _NET_STARTUP_ID or else its pid. Launches older than launchwait
+ * seconds are forgotten. */
+Launch *
+findlaunch(Window w, pid_t pid)
+{
+  char id[sizeof launches[0].id];
+  const uint64_t now = nowus();
+  Launch *l, *found = NULL;
+
+  if (!gettextprop(w, netatom[NetStartupId], id, sizeof id))
+    id[0] = '\0';
+  for (l = launches; l < launches + LAUNCHES; l++) {
+    if (!l->pid)
+      continue;
+    if (now - l->started > launchwait * 1000000ULL)
+      l->pid = 0;
+    else if (!found && ((id[0] && !strcmp(id, l->id)) || (pid > 0 && pid == l->pid)))
+      found = l;
+  }
+  if (found && !found->mapped) {
+    found->mapped = 1;
+    found->win = w;
+  }
+  return found;
+}
+
+void
+flushdeferred(void)
+{
+  uint what;
+
+  batching = 0;
+  for (Monitor *m = mons; m; m = m->next) {
+    what = m->pending;
+    m->pending = 0;
+    if (what & PendArrange)
+      arrange(m);
+    else if (what & PendRestack)
+      restack(m);
+    /* the input focus goes to the selected client once it is mapped */
+    if ((what & PendFocus) && m == selmon && m->sel)
+      setfocus(m->sel);
+    if (what & PendBar)
+      drawbar(m);
+    else if (what & PendStatus)
       drawbar_status(m);
+  }
 }
 
 void
@@ -1190,13 +1671,15 @@ focus(Client *c)
 
     size_t si = SchemeSel1 + c->pane_idx;
     XSetWindowBorder(dpy, c->win, scheme[si][ColBorder].pixel);
-    setfocus(c);
+    if (!deferred(c->mon, PendFocus))
+      setfocus(c);
   } else {
     XSetInputFocus(dpy, root, RevertToPointerRoot, CurrentTime);
     XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
   }
   selmon->sel = c;
-  if (c && c->mon->status_idx < BAR_STATUS_CUSTOM)
+  if (c && (statusshown(c->mon, BAR_STATUS_WIN_TITLE)
+	    || statusshown(c->mon, BAR_STATUS_WORKSPACES)))
     drawbar_status(c->mon);
 }
 
@@ -1210,6 +1693,29 @@ focusin(XEvent *e)
     setfocus(selmon->sel);
 }
 
+/* select the client of window arg->ui, going to its workspace and
+ * showing its pane */
+void
+focuswin(const Arg *arg)
+{
+  Client *c;
+
+  if (!arg || !(c = wintoclient(arg->ui)))
+    return;
+  if (c->mon != selmon) {
+    unfocus(selmon->sel, 1);
+    selmon = c->mon;
+  }
+  if (c->ws_idx != selmon->ws_idx)
+    switchworkspace(&(Arg){ .ws = { c->ws_idx, selmon->alt_idx } });
+  if (!c->isfloating && !ISSHOWING(selmon, c->pane_idx)) {
+    selmon->selws->panes[c->pane_idx].showing = 1;
+    arrange(selmon);
+  }
+  focus(c);
+  restack(selmon);
+}
+
 void
 focuspane_to(uint i)
 {
@@ -1265,6 +1771,159 @@ focuspane_showing(const Arg *arg)
   focuspane_to(i);
 }
 
+/* Freeze the processes of opted-in clients that have not been visible for
+ * freezegrace seconds. Called from the one second tick. */
+void
+freezeclients(void)
+{
+  const uint64_t now = nowus();
+  Monitor *m, *m2;
+  Client *c, *c2;
+
+  for (m = mons; m; m = m->next)
+    for (c = m->clients; c; c = c->next) {
+      if (!c->canfreeze || c->isfrozen || !c->ishidden || c->pid <= 0
+	  || now - c->hiddensince < freezegrace * 1000000ULL)
+	continue;
+      /* other windows of the same process may still be on screen */
+      for (m2 = mons; m2; m2 = m2->next)
+	for (c2 = m2->clients; c2; c2 = c2->next)
+	  if (c2->pid == c->pid && !c2->ishidden)
+	    goto next;
+      freezepid(c->pid);
+      for (m2 = mons; m2; m2 = m2->next)
+	for (c2 = m2->clients; c2; c2 = c2->next)
+	  if (c2->pid == c->pid)
+	    c2->isfrozen = 1;
+    next:;
+    }
+}
+
+/* pid and all its descendants, read from /proc */
+static size_t
+proctree(pid_t pid, pid_t **out)
+{
+  struct { pid_t pid, ppid; } *procs = NULL;
+  size_t nprocs = 0, cap = 0, n = 1, i, j;
+  struct dirent *e;
+  char path[300], buf[512], *p;
+  FILE *fp;
+  DIR *d;
+
+  if ((d = opendir("/proc"))) {
+    while ((e = readdir(d))) {
+      if (e->d_name[0] < '1' || e->d_name[0] > '9')
+	continue;
+      snprintf(path, sizeof path, "/proc/%s/stat", e->d_name);
+      if (!(fp = fopen(path, "r")))
+	continue;
+      p = fgets(buf, sizeof buf, fp);
+      fclose(fp);
+      /* the command name may contain anything, skip past its ')' */
+      if (!p || !(p = strrchr(buf, ')')))
+	continue;
+      if (nprocs == cap) {
+	cap = cap ? cap * 2 : 256;
+	if (!(procs = realloc(procs, cap * sizeof *procs)))
+	  die("realloc:");
+      }
+      procs[nprocs].pid = atoi(e->d_name);
+      procs[nprocs].ppid = atoi(p + 4); /* ") S ppid" */
+      nprocs++;
+    }
+    closedir(d);
+  }
+
+  *out = ecalloc(nprocs + 1, sizeof **out);
+  (*out)[0] = pid;
+  for (i = 0; i < n; i++)
+    for (j = 0; j < nprocs; j++)
+      if (procs[j].ppid == (*out)[i] && n <= nprocs)
+	(*out)[n++] = procs[j].pid;
+  free(procs);
+  return n;
+}
+
+/* whether every process of cgroup cg is one of the n in tree */
+static int
+cgroupowned(const char *cg, const pid_t *tree, size_t n)
+{
+  char path[320];
+  FILE *fp;
+  size_t i;
+  int pid, seen = 0, ok = 1;
+
+  snprintf(path, sizeof path, "/sys/fs/cgroup%s/cgroup.procs", cg);
+  if (!(fp = fopen(path, "r")))
+    return 0;
+  while (ok && fscanf(fp, "%d", &pid) == 1) {
+    for (i = 0; i < n && tree[i] != pid; i++);
+    ok = i < n;
+    seen = 1;
+  }
+  fclose(fp);
+  return ok && seen;
+}
+
+/* the cgroup v2 directory of pid, relative to /sys/fs/cgroup */
+static int
+proccgroup(pid_t pid, char *path, size_t size)
+{
+  char buf[256];
+  FILE *fp;
+  int found = 0;
+
+  snprintf(buf, sizeof buf, "/proc/%d/cgroup", (int)pid);
+  if (!(fp = fopen(buf, "r")))
+    return 0;
+  while (!found && fgets(buf, sizeof buf, fp))
+    if (!strncmp(buf, "0::", 3)) {
+      buf[strcspn(buf, "\n")] = '\0';
+      snprintf(path, size, "%s", buf + 3);
+      found = 1;
+    }
+  fclose(fp);
+  return found;
+}
+
+static int
+writefile(const char *path, const char *text)
+{
+  FILE *fp;
+  int ok;
+
+  if (!(fp = fopen(path, "w")))
+    return 0;
+  ok = fputs(text, fp) >= 0;
+  return fclose(fp) == 0 && ok;
+}
+
+/* Stop pid with its whole process tree. A cgroup v2 freezer is used when
+ * the process tree has a cgroup to itself, so that nothing else in it,
+ * like the X server sharing a session scope, is stopped with it;
+ * otherwise every process of the tree gets a SIGSTOP. */
+void
+freezepid(pid_t pid)
+{
+  Freezer *f = ecalloc(1, sizeof(Freezer));
+  char cg[256];
+
+  f->pid = pid;
+  f->ntree = proctree(pid, &f->tree);
+  if (proccgroup(pid, cg, sizeof cg) && strcmp(cg, "/") != 0
+      && cgroupowned(cg, f->tree, f->ntree)) {
+    snprintf(f->cgfreeze, sizeof f->cgfreeze, "/sys/fs/cgroup%s/cgroup.freeze", cg);
+    if (!writefile(f->cgfreeze, "1"))
+      f->cgfreeze[0] = '\0';
+  }
+  if (!f->cgfreeze[0])
+    for (size_t i = 0; i < f->ntree; i++)
+      kill(f->tree[i], SIGSTOP);
+  f->next = freezers;
+  freezers = f;
+  stats.frozen++;
+}
+
 Atom
 getatomprop(Client *c, Atom prop)
 {
@@ -1280,6 +1939,35 @@ getatomprop(Client *c, Atom prop)
   return atom;
 }
 
+/* The _NET_WM_PID of w, 0 if it has none or its WM_CLIENT_MACHINE is
+ * not this host: the pid of a remote client means some other process
+ * here. */
+pid_t
+getpidprop(Window w)
+{
+  int di;
+  unsigned long dl;
+  unsigned char *p = NULL;
+  char host[256];
+  XTextProperty tp;
+  Atom da;
+  pid_t pid = 0;
+  int local;
+
+  if (gethostname(host, sizeof host) == -1 || !XGetWMClientMachine(dpy, w, &tp))
+    return 0;
+  host[sizeof host - 1] = '\0';
+  local = tp.value && tp.format == 8 && tp.nitems == strlen(host)
+    && !memcmp(tp.value, host, tp.nitems);
+  XFree(tp.value);
+  if (local && XGetWindowProperty(dpy, w, netatom[NetWMPid], 0L, 1L, False, XA_CARDINAL,
+			 &da, &di, &dl, &dl, &p) == Success && p) {
+    pid = *(unsigned long *)p;
+    XFree(p);
+  }
+  return pid;
+}
+
 int
 getrootptr(int *x, int *y)
 {
@@ -1307,6 +1995,30 @@ getstate(Window w)
   return result;
 }
 
+/* the counter of a client that takes _NET_WM_SYNC_REQUEST, or None */
+XSyncCounter
+getsynccounter(Client *c)
+{
+  int format, n, found = 0;
+  unsigned long nitems, extra;
+  unsigned char *p = NULL;
+  Atom real, *protocols;
+  XSyncCounter counter = None;
+
+  if (!havesync || !XGetWMProtocols(dpy, c->win, &protocols, &n))
+    return None;
+  while (!found && n--)
+    found = protocols[n] == netatom[NetWMSyncRequest];
+  XFree(protocols);
+  if (found && XGetWindowProperty(dpy, c->win, netatom[NetWMSyncRequestCounter], 0L, 1L,
+				  False, XA_CARDINAL, &real, &format, &nitems, &extra, &p) == Success) {
+    if (nitems == 1 && format == 32)
+      counter = *(long *)p;
+    XFree(p);
+  }
+  return counter;
+}
+
 int
 gettextprop(Window w, Atom atom, char *text, unsigned int size)
 {
@@ -1351,6 +2063,29 @@ grabbuttons(Client *c, int focused)
   }
 }
 
+/* the next event for a pointer grab loop, waiting at most timeout ms
+ * unless it is negative; a timeout gives an event of type 0 */
+int
+grabevent(XEvent *ev, int timeout)
+{
+  struct pollfd pfd = { .fd = ConnectionNumber(dpy), .events = POLLIN };
+  const uint64_t end = nowus() + (uint64_t)timeout * 1000;
+  int64_t left;
+
+  if (timeout < 0) {
+    XIfEvent(dpy, ev, isgrabevent, NULL);
+    return 1;
+  }
+  while (!XCheckIfEvent(dpy, ev, isgrabevent, NULL)) {
+    if ((left = (int64_t)(end - nowus())) <= 0) {
+      ev->type = 0;
+      return 0;
+    }
+    poll(&pfd, 1, (left + 999) / 1000);
+  }
+  return 1;
+}
+
 void
 grabkeys(void)
 {
@@ -1379,10 +2114,22 @@ grabkeys(void)
   }
 }
 
+/* Crossing events carry the serial of the last request the server ran
+ * before them, so those up to the last request sent so far come from our
+ * own stacking and configuring, not from the pointer; enternotify()
+ * skips them. The no-op gives events of later pointer motion a newer
+ * serial, so they are not taken for ours. */
 void
-inc_div_ratio(const Arg *arg)
+ignoreenter(void)
 {
-  if (!arg) return;
+  enterserial = NextRequest(dpy) - 1;
+  XNoOp(dpy);
+}
+
+void
+inc_div_ratio(const Arg *arg)
+{
+  if (!arg) return;
 
   Workspace *ws = selmon->selws;
   if (ws->selpane >= WS_PANES) return;
@@ -1423,20 +2170,396 @@ isuniquegeom(XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
 }
 #endif /* XINERAMA */
 
+void
+ipcaccept(void)
+{
+  int fd, ours;
+  uint i;
+#ifdef __linux__
+  struct ucred cr;
+  socklen_t len = sizeof cr;
+#else
+  uid_t uid;
+  gid_t gid;
+#endif
+
+  if ((fd = accept(ipcfd, NULL, NULL)) == -1)
+    return;
+  /* the commands spawn as us, so nobody else may give them */
+#ifdef __linux__
+  ours = !getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cr, &len) && cr.uid == getuid();
+#else
+  ours = !getpeereid(fd, &uid, &gid) && uid == getuid();
+#endif
+  if (!ours) {
+    close(fd);
+    return;
+  }
+  for (i = 0; i < LENGTH(ipcclients) && ipcclients[i].fd != -1; i++);
+  if (i == LENGTH(ipcclients)) {
+    close(fd);
+    return;
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  ipcclients[i].fd = fd;
+  ipcclients[i].len = 0;
+}
+
+void
+ipccleanup(void)
+{
+  for (uint i = 0; i < LENGTH(ipcclients); i++)
+    if (ipcclients[i].fd != -1)
+      ipcdrop(&ipcclients[i]);
+  if (ipcfd != -1) {
+    close(ipcfd);
+    unlink(ipcpath);
+  }
+}
+
+void
+ipcdrop(IpcClient *ic)
+{
+  close(ic->fd);
+  if (ic->events)
+    ipcsubs--;
+  ic->fd = -1;
+  ic->len = ic->outlen = 0;
+  ic->events = 0;
+  ic->dropped = 0;
+}
+
+/* Queue an event for the clients subscribed to ev and send what their
+ * sockets take without blocking. */
+void
+ipcevent(uint ev, const char *fmt, ...)
+{
+  char buf[512];
+  va_list ap;
+  int len;
+  uint i;
+
+  if (!ipcsubs)
+    return;
+  va_start(ap, fmt);
+  len = vsnprintf(buf, sizeof buf, fmt, ap);
+  va_end(ap);
+  if (len < 0)
+    return;
+  len = MIN(len, (int)sizeof buf - 1);
+  for (i = 0; i < LENGTH(ipcclients); i++)
+    if (ipcclients[i].fd != -1 && ipcclients[i].events & 1 << ev) {
+      ipcqueue(&ipcclients[i], buf, len);
+      ipcflush(&ipcclients[i]);
+    }
+}
+
+/* Run one command, "name [args]". Window ids and the like may be given
+ * in any base strtoul() takes. */
+int
+ipcexec(char *cmd, char *err, size_t size)
+{
+  const IpcCommand *c = NULL;
+  char *argv[32], *p, *sp, *end;
+  Arg arg = {0};
+  int n = 0;
+  uint i;
+
+  for (p = strtok_r(cmd, " \t", &sp); p && n < LENGTH(argv) - 1; p = strtok_r(NULL, " \t", &sp))
+    argv[n++] = p;
+  argv[n] = NULL;
+  if (!n)
+    return 0;
+  for (i = 0; i < LENGTH(ipccommands) && !c; i++)
+    if (!strcmp(ipccommands[i].name, argv[0]))
+      c = &ipccommands[i];
+  if (!c) {
+    snprintf(err, size, "%s: no such command", argv[0]);
+    return -1;
+  }
+  switch (c->type) {
+  case IpcNone:
+    n = n == 1;
+    break;
+  case IpcInt:
+    n = n == 2 && (arg.i = strtol(argv[1], &end, 0), !*end);
+    break;
+  case IpcUint:
+    n = n == 2 && (arg.ui = strtoul(argv[1], &end, 0), !*end);
+    break;
+  case IpcWs:
+    n = n == 3 && (arg.ws.idx = strtol(argv[1], &end, 0), !*end)
+      && (arg.ws.alt = strtol(argv[2], &end, 0), !*end);
+    break;
+  case IpcCmd:
+    arg.v = argv + 1;
+    n = n > 1;
+    break;
+  }
+  if (!n) {
+    snprintf(err, size, "%s: bad arguments", argv[0]);
+    return -1;
+  }
+  c->func(&arg);
+  return 0;
+}
+
+void
+ipcflush(IpcClient *ic)
+{
+  ssize_t n;
+
+  if (!ic->outlen)
+    return;
+  if ((n = send(ic->fd, ic->out, ic->outlen, MSG_NOSIGNAL | MSG_DONTWAIT)) == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      ipcdrop(ic);
+    return;
+  }
+  ic->outlen -= n;
+  memmove(ic->out, ic->out + n, ic->outlen);
+}
+
+void
+ipcinit(void)
+{
+  struct sockaddr_un sa = { .sun_family = AF_UNIX };
+  struct stat st;
+  const char *p;
+  uint i;
+
+  for (i = 0; i < LENGTH(ipcclients); i++)
+    ipcclients[i].fd = -1;
+  if ((p = getenv("DZWM_SOCKET")))
+    snprintf(ipcpath, sizeof ipcpath, "%s", p);
+  else if (sockpath(ipcpath, sizeof ipcpath, DisplayString(dpy)) == -1) {
+    fprintf(stderr, "dzwm: no command socket: %s\n", strerror(errno));
+    return;
+  }
+  memcpy(sa.sun_path, ipcpath, sizeof sa.sun_path);
+  /* replace the socket a dead dzwm left, but no other kind of file */
+  if (!lstat(ipcpath, &st) && S_ISSOCK(st.st_mode))
+    unlink(ipcpath);
+  if ((ipcfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) == -1
+      || bind(ipcfd, (struct sockaddr *)&sa, sizeof sa) == -1
+      || chmod(ipcpath, 0600) == -1
+      || listen(ipcfd, 8) == -1) {
+    fprintf(stderr, "dzwm: no command socket at %s: %s\n", ipcpath, strerror(errno));
+    if (ipcfd != -1)
+      close(ipcfd);
+    ipcfd = -1;
+    return;
+  }
+  setenv("DZWM_SOCKET", ipcpath, 1);
+}
+
+/* tell subscribers how the monitors and the focus changed since the
+ * last call, which comes once per round of the event loop */
+void
+ipcnotify(void)
+{
+  const Workspace *ws;
+  Window sel = selmon && selmon->sel ? selmon->sel->win : None;
+  uint i, showing;
+
+  for (Monitor *m = mons; m; m = m->next) {
+    if (m->ws_idx != m->evws || m->alt_idx != m->evalt) {
+      ipcevent(EvWorkspace, "workspace %d %u %u", m->num, m->ws_idx, m->alt_idx);
+      m->evws = m->ws_idx;
+      m->evalt = m->alt_idx;
+    }
+    ws = m->selws;
+    for (i = 0, showing = 0; i < WS_PANES; i++) {
+      showing |= !!ws->panes[i].showing << i;
+      if ((showing ^ m->evshowing) & 1 << i)
+	ipcevent(EvPane, "pane %d %u %d", m->num, i, ws->panes[i].showing);
+      if (ws->panes[i].layout_idx != m->evlayout[i]) {
+	ipcevent(EvLayout, "layout %d %u %s", m->num, i,
+		 layouts[ws->panes[i].layout_idx].symbol);
+	m->evlayout[i] = ws->panes[i].layout_idx;
+      }
+    }
+    m->evshowing = showing;
+  }
+  if (sel != evsel) {
+    ipcevent(EvFocus, "focus 0x%lx", sel);
+    evsel = sel;
+  }
+}
+
+/* Append a frame, a 4 byte big endian length and then the event. A
+ * frame that does not fit is dropped and counted, and the count goes
+ * out as a "dropped" event once there is room again. */
+int
+ipcqueue(IpcClient *ic, const char *ev, size_t len)
+{
+  char buf[32];
+  int n;
+
+  if (ic->dropped) {
+    n = snprintf(buf, sizeof buf, "dropped %lu", ic->dropped);
+    if (ic->outlen + 4 + n + 4 + len > sizeof ic->out) {
+      ic->dropped++;
+      return -1;
+    }
+    ic->dropped = 0;
+    ipcqueue(ic, buf, n);
+  }
+  if (ic->outlen + 4 + len > sizeof ic->out) {
+    ic->dropped++;
+    return -1;
+  }
+  ic->out[ic->outlen++] = len >> 24;
+  ic->out[ic->outlen++] = len >> 16;
+  ic->out[ic->outlen++] = len >> 8;
+  ic->out[ic->outlen++] = len;
+  memcpy(ic->out + ic->outlen, ev, len);
+  ic->outlen += len;
+  return 0;
+}
+
+/* Each line a client sends is a batch of commands separated by ';'. Its
+ * arranging and drawing is done once, after the last of them, and the
+ * reply is "ok" or the first error. */
+void
+ipcread(IpcClient *ic)
+{
+  char err[128], reply[160], *line, *nl, *cmd, *sp;
+  ssize_t n;
+  size_t len;
+
+  if ((n = read(ic->fd, ic->buf + ic->len, sizeof ic->buf - ic->len)) <= 0) {
+    if (n == 0 || errno != EAGAIN)
+      ipcdrop(ic);
+    return;
+  }
+  /* a subscriber has nothing more to say */
+  if (ic->events)
+    return;
+  ic->len += n;
+  for (line = ic->buf; (nl = memchr(line, '\n', ic->buf + ic->len - line)); line = nl + 1) {
+    *nl = '\0';
+    err[0] = '\0';
+    if (!strncmp(line, "subscribe", 9) && (!line[9] || line[9] == ' ')) {
+      if (ipcsubscribe(ic, line + 9, err, sizeof err) == -1) {
+	len = snprintf(reply, sizeof reply, "error: %s\n", err);
+	if (send(ic->fd, reply, len, MSG_NOSIGNAL | MSG_DONTWAIT) != (ssize_t)len) {
+	  ipcdrop(ic);
+	  return;
+	}
+	continue;
+      }
+      ic->len = 0;
+      return;
+    }
+    if (!strcmp(line, "stats"))
+      /* the counters of barstatus_stats, for the benchmark scripts */
+      len = snprintf(reply, sizeof reply, "ok wakeups %lu maps %u map %llu maxmap %llu adopted %u\n",
+		     stats.wakeups, stats.maps, (unsigned long long)stats.map_last_us,
+		     (unsigned long long)stats.map_max_us, stats.adopted);
+    else {
+      batching = 1;
+      for (cmd = strtok_r(line, ";", &sp); cmd; cmd = strtok_r(NULL, ";", &sp))
+	if (ipcexec(cmd, err, sizeof err) == -1)
+	  break;
+      flushdeferred();
+      len = snprintf(reply, sizeof reply, err[0] ? "error: %s\n" : "ok\n", err);
+    }
+    /* a client that does not read its replies is not waited for */
+    if (send(ic->fd, reply, len, MSG_NOSIGNAL | MSG_DONTWAIT) != (ssize_t)len) {
+      ipcdrop(ic);
+      return;
+    }
+  }
+  ic->len -= line - ic->buf;
+  memmove(ic->buf, line, ic->len);
+  if (ic->len == sizeof ic->buf)
+    ipcdrop(ic);
+}
+
+/* Turn ic into a subscriber of the named events, all of them if none is
+ * named. It gets "ok" and from then on only events. */
+int
+ipcsubscribe(IpcClient *ic, char *names, char *err, size_t size)
+{
+  char *p, *sp;
+  uint i, events = 0;
+
+  for (p = strtok_r(names, " \t", &sp); p; p = strtok_r(NULL, " \t", &sp)) {
+    for (i = 0; i < EvLast && strcmp(evnames[i], p); i++);
+    if (i == EvLast) {
+      snprintf(err, size, "%s: no such event", p);
+      return -1;
+    }
+    events |= 1 << i;
+  }
+  ic->events = events ? events : (1 << EvLast) - 1;
+  ipcsubs++;
+  memcpy(ic->out, "ok\n", 3);
+  ic->outlen = 3;
+  ipcflush(ic);
+  return 0;
+}
+
+Bool
+isgrabevent(Display *d, XEvent *ev, XPointer arg)
+{
+  switch (ev->type) {
+  case ButtonPress:
+  case ButtonRelease:
+  case MotionNotify:
+  case Expose:
+  case ConfigureRequest:
+  case MapRequest:
+  case CirculateRequest:
+    return True;
+  }
+  return havesync && ev->type == syncevbase + XSyncAlarmNotify;
+}
+
+/* MotionNotify events up to the first button event; arg points to an int
+ * that remembers whether one was seen */
+Bool
+ismotion(Display *d, XEvent *ev, XPointer arg)
+{
+  if (ev->type == ButtonPress || ev->type == ButtonRelease)
+    *(int *)arg = 1;
+  return !*(int *)arg && ev->type == MotionNotify;
+}
+
 void
 keypress(XEvent *e)
 {
-  unsigned int i;
+  unsigned int i, j, n = 0;
   KeySym keysym;
   XKeyEvent *ev;
 
   ev = &e->xkey;
   keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
+  /* when every binding of the key takes repeats, run the auto-repeats
+   * already queued behind it now, arranging and drawing once */
   for (i = 0; i < LENGTH(keys); i++)
     if (keysym == keys[i].keysym
 	&& CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
-	&& keys[i].func)
-      keys[i].func(&(keys[i].arg));
+	&& keys[i].func) {
+      for (j = 0; j < LENGTH(repeatfuncs) && repeatfuncs[j] != keys[i].func; j++);
+      if (j == LENGTH(repeatfuncs))
+	break;
+      n = 1;
+    }
+  if (n && i == LENGTH(keys) && (n += takerepeats(ev)) > 1)
+    batching = 1;
+  else
+    n = 1;
+  for (j = 0; j < n; j++)
+    for (i = 0; i < LENGTH(keys); i++)
+      if (keysym == keys[i].keysym
+	  && CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
+	  && keys[i].func)
+	keys[i].func(&(keys[i].arg));
+  if (batching)
+    flushdeferred();
 }
 
 void
@@ -1461,6 +2584,9 @@ manage(Window w, XWindowAttributes *wa)
   Client *c, *t = NULL;
   Window trans = None;
   XWindowChanges wc;
+  XClassHint ch = { NULL, NULL };
+  Launch *l;
+  size_t i;
 
   c = ecalloc(1, sizeof(Client));
   c->win = w;
@@ -1472,10 +2598,17 @@ manage(Window w, XWindowAttributes *wa)
   c->oldbw = wa->border_width;
 
   updatetitle(c);
+  c->pid = getpidprop(w);
   if (XGetTransientForHint(dpy, w, &trans) && (t = wintoclient(trans))) {
     c->mon = t->mon;
     c->ws_idx = t->ws_idx;
     c->pane_idx = t->pane_idx;
+  } else if ((l = findlaunch(w, c->pid))) {
+    /* where it was spawned, even if the user has moved on since */
+    c->mon = l->mon;
+    c->isfloating = 0;
+    c->ws_idx = l->ws_idx;
+    c->pane_idx = l->pane_idx;
   } else {
     c->mon = selmon;
     c->isfloating = 0;
@@ -1498,7 +2631,17 @@ manage(Window w, XWindowAttributes *wa)
   updatewindowtype(c);
   updatesizehints(c);
   updatewmhints(c);
-  XSelectInput(dpy, w, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
+  if (c->pid > 0 && c->pid != getpid() && XGetClassHint(dpy, w, &ch)) {
+    for (i = 0; i < LENGTH(freezeclasses) && freezeclasses[i]; i++)
+      if ((ch.res_class && !strcmp(ch.res_class, freezeclasses[i]))
+	  || (ch.res_name && !strcmp(ch.res_name, freezeclasses[i])))
+	c->canfreeze = 1;
+    if (ch.res_class)
+      XFree(ch.res_class);
+    if (ch.res_name)
+      XFree(ch.res_name);
+  }
+  XSelectInput(dpy, w, CLIENTMASK);
   grabbuttons(c, 0);
   if (!c->isfloating)
     c->isfloating = c->oldstate = trans != None || c->isfixed;
@@ -1506,18 +2649,50 @@ manage(Window w, XWindowAttributes *wa)
     XRaiseWindow(dpy, c->win);
   attach(c);
   attachstack(c);
-  XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend,
-		  (unsigned char *) &(c->win), 1);
+  attachws(c);
+  ipcevent(EvAdd, "add 0x%lx %u %u", c->win, c->ws_idx, c->pane_idx);
   XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h); /* some windows require this */
+  c->ishidden = 1;
+  c->hiddensince = nowus(); /* freezegrace counts from here if it stays hidden */
   setclientstate(c, NormalState);
-  if (c->mon == selmon)
-    unfocus(selmon->sel, 0);
-  c->mon->sel = c;
+  if (ISVISIBLE(c)) {
+    if (c->mon == selmon)
+      unfocus(selmon->sel, 0);
+    c->mon->sel = c;
+  }
   arrange(c->mon);
-  XMapWindow(dpy, c->win);
+  if (c->ishidden && hideiconic)
+    seticonic(c, 1); /* scan() may have found it mapped */
+  else
+    XMapWindow(dpy, c->win);
   focus(NULL);
 }
 
+/* a window spawn() launched or took from the pool is visible now */
+void
+mapnotify(XEvent *e)
+{
+  Window w = e->xmap.window;
+  uint64_t t0 = 0;
+  Launch *l;
+
+  if (w == adoptwin) {
+    t0 = adoptstart;
+    adoptwin = None;
+  } else
+    for (l = launches; l < launches + LAUNCHES; l++)
+      if (l->pid && l->win == w) {
+	t0 = l->started;
+	l->win = None;
+	break;
+      }
+  if (!t0)
+    return;
+  stats.maps++;
+  stats.map_last_us = nowus() - t0;
+  stats.map_max_us = MAX(stats.map_max_us, stats.map_last_us);
+}
+
 void
 mappingnotify(XEvent *e)
 {
@@ -1536,7 +2711,7 @@ maprequest(XEvent *e)
 
   if (!XGetWindowAttributes(dpy, ev->window, &wa) || wa.override_redirect)
     return;
-  if (!wintoclient(ev->window))
+  if (!wintoclient(ev->window) && !poolhold(ev->window))
     manage(ev->window, &wa);
 }
 
@@ -1565,23 +2740,6 @@ maximize(const Arg *arg)
   }
 }
 
-void
-motionnotify(XEvent *e)
-{
-  static Monitor *mon = NULL;
-  Monitor *m;
-  XMotionEvent *ev = &e->xmotion;
-
-  if (ev->window != root)
-    return;
-  if ((m = recttomon(ev->x_root, ev->y_root, 1, 1)) != mon && mon) {
-    unfocus(selmon->sel, 1);
-    selmon = m;
-    focus(NULL);
-  }
-  mon = m;
-}
-
 void
 moveclient_pane(const Arg *arg)
 {
@@ -1635,7 +2793,9 @@ moveclient_ws(const Arg *arg)
   if (!selmon->sel) return;
   if (arg->ui >= WS_LEN) return;
 
+  detachws(selmon->sel);
   selmon->sel->ws_idx = arg->ui;
+  attachws(selmon->sel);
   unfocus(selmon->sel, 1);
   focus(NULL);
 
@@ -1657,7 +2817,6 @@ movemouse(const Arg *arg)
   Client *c;
   Monitor *m;
   XEvent ev;
-  Time lasttime = 0;
 
   if (!(c = selmon->sel))
     return;
@@ -1680,10 +2839,7 @@ movemouse(const Arg *arg)
       handler[ev.type](&ev);
       break;
     case MotionNotify:
-      if ((ev.xmotion.time - lasttime) <= (1000 / 60))
-	continue;
-      lasttime = ev.xmotion.time;
-
+      compressmotion(&ev);
       nx = ocx + (ev.xmotion.x - x);
       ny = ocy + (ev.xmotion.y - y);
       if (abs(selmon->wx - nx) < snap)
@@ -1715,51 +2871,21 @@ movestack(const Arg *arg)
 {
   if (!selmon->sel || selmon->sel->isfloating) return;
 
-  Client *c = NULL, *p = NULL, *pc = NULL, *i;
+  Client *c;
   const uint pi = selmon->sel->pane_idx;
 
   if (arg->i > 0) {
     /* find the client after selmon->sel */
-    for (c = selmon->sel->next; c && !ISTILED(c, pi); c = c->next);
-    if (!c)
-      for (c = selmon->clients; c && !ISTILED(c, pi); c = c->next);
-  }
-  else {
+    if (!(c = nexttiled(selmon->sel->next, pi)))
+      c = nexttiled(selmon->clients, pi);
+  } else {
     /* find the client before selmon->sel */
-    for (i = selmon->clients; i != selmon->sel; i = i->next)
-      if (ISTILED(i, pi))
-	c = i;
-    if (!c)
-      for (; i; i = i->next)
-	if (ISTILED(i, pi))
-	  c = i;
+    c = prevtiled(selmon->sel, pi);
   }
 
   if (!c || c == selmon->sel) return;
 
-  /* find the client before selmon->sel and c */
-  for (i = selmon->clients; i && (!p || !pc); i = i->next) {
-    if (i->next == selmon->sel)
-      p = i;
-    if (i->next == c)
-      pc = i;
-  }
-
-  /* swap c and selmon->sel selmon->clients in the selmon->clients list */
-  Client *temp = selmon->sel->next == c ? selmon->sel : selmon->sel->next;
-  selmon->sel->next = c->next == selmon->sel ? c : c->next;
-  c->next = temp;
-
-  if (p && p != c)
-    p->next = c;
-  if (pc && pc != selmon->sel)
-    pc->next = selmon->sel;
-
-  if (selmon->sel == selmon->clients)
-    selmon->clients = c;
-  else if (c == selmon->clients)
-    selmon->clients = selmon->sel;
-
+  swapclients(selmon->sel, c);
   arrange(selmon);
 }
 
@@ -1774,6 +2900,58 @@ nexttiled(Client *c, uint pi)
   return NULL;
 }
 
+uint64_t
+nowus(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void
+pin_bar_status(const Arg *arg)
+{
+  if (!arg || arg->ui >= BAR_STATUS_CNT)
+    return;
+
+  selmon->pinned[arg->ui] = !selmon->pinned[arg->ui];
+  drawbar_status(selmon);
+}
+
+/* Queue the static bar strings from config.h, so that the first time one
+ * of them is shown does not pay for font lookup and glyph rasterisation.
+ * run() works the queue off in prewarmslice steps while idle. */
+void
+prewarmbar(void)
+{
+  uint i;
+
+  for (i = 0; i < LENGTH(wsnames); i++)
+    drw_prewarm(drw, wsnames[i]);
+  for (i = 0; i < LENGTH(altnames); i++)
+    drw_prewarm(drw, altnames[i]);
+  for (i = 0; i < LENGTH(panenames); i++)
+    drw_prewarm(drw, panenames[i]);
+  for (i = 0; i < LENGTH(statusrenderspecs); i++)
+    drw_prewarm(drw, statusrenderspecs[i].icon);
+  for (i = 0; i < LENGTH(layouts); i++)
+    drw_prewarm(drw, layouts[i].symbol);
+  drw_prewarm(drw, "...");
+}
+
+/* the tiled client before c, wrapping around to the tail */
+Client *
+prevtiled(Client *c, uint pi)
+{
+  Client *i;
+
+  for (i = c->prev; i != c; i = i->prev)
+    if (ISTILED(i, pi))
+      return i;
+  return NULL;
+}
+
 void
 pop(Client *c)
 {
@@ -1783,6 +2961,105 @@ pop(Client *c)
   arrange(c->mon);
 }
 
+/* Show a held instance of cmd in the selected pane, if there is one,
+ * and start another in its place. Returns the window it showed. */
+Window
+pooladopt(const char **cmd)
+{
+  XWindowAttributes wa;
+  Pooled *p;
+  Window w;
+
+  for (p = pool; p < pool + POOL_MAX; p++)
+    if (p->pid && p->win && p->pc->cmd == cmd)
+      break;
+  if (p == pool + POOL_MAX)
+    return None;
+  poolover[p->pc - poolcmds] = 0;
+  if (!XGetWindowAttributes(dpy, p->win, &wa)) {
+    /* its window is gone, so is the use of it */
+    kill(p->pid, SIGTERM);
+    p->pid = 0;
+    pooltick();
+    return None;
+  }
+  p->pid = 0;
+  w = p->win;
+  manage(w, &wa);
+  pooltick();
+  return w;
+}
+
+/* Keep the window w unmapped and on no workspace if it belongs to an
+ * instance of a pool command, matched by _NET_STARTUP_ID or pid. */
+int
+poolhold(Window w)
+{
+  char id[sizeof pool[0].id];
+  pid_t pid;
+  Pooled *p;
+
+  if (!gettextprop(w, netatom[NetStartupId], id, sizeof id))
+    id[0] = '\0';
+  pid = getpidprop(w);
+  for (p = pool; p < pool + POOL_MAX; p++)
+    if (p->pid && (p->win == w
+		   || (!p->win && ((id[0] && !strcmp(id, p->id)) || pid == p->pid)))) {
+      p->win = w;
+      return 1;
+    }
+  return 0;
+}
+
+/* Forget pooled instances that have exited, stop those grown past their
+ * maxrss and start new ones up to each command's size. A command whose
+ * instance was stopped or could not be started is not refilled until
+ * one of it is taken. Called from the one second tick. */
+void
+pooltick(void)
+{
+  const unsigned long pagekb = sysconf(_SC_PAGESIZE) / 1024;
+  unsigned long pages;
+  char path[64];
+  Pooled *p;
+  FILE *fp;
+  uint i, n;
+
+  for (p = pool; p < pool + POOL_MAX; p++) {
+    if (!p->pid)
+      continue;
+    if (kill(p->pid, 0) == -1 && errno == ESRCH) {
+      p->pid = 0;
+      continue;
+    }
+    snprintf(path, sizeof path, "/proc/%d/statm", (int)p->pid);
+    if (!p->pc->maxrss || !(fp = fopen(path, "r")))
+      continue;
+    if (fscanf(fp, "%*u %lu", &pages) == 1 && pages * pagekb > p->pc->maxrss) {
+      kill(p->pid, SIGTERM);
+      poolover[p->pc - poolcmds] = 1;
+      p->pid = 0;
+    }
+    fclose(fp);
+  }
+  for (i = 0; i < LENGTH(poolcmds); i++) {
+    for (n = 0, p = pool; p < pool + POOL_MAX; p++)
+      n += p->pid && p->pc == &poolcmds[i];
+    for (; n < poolcmds[i].size && !poolover[i]; n++) {
+      for (p = pool; p < pool + POOL_MAX && p->pid; p++);
+      if (p == pool + POOL_MAX)
+	return;
+      snprintf(p->id, sizeof p->id, WM_MY_NAME "-%d-%u", (int)getpid(), ++launchseq);
+      if ((p->pid = spawncmd((char **)poolcmds[i].cmd, p->id)) == -1) {
+	p->pid = 0;
+	poolover[i] = 1;
+      }
+      p->pc = &poolcmds[i];
+      p->win = None;
+    }
+  }
+}
+
 void
 propertynotify(XEvent *e)
 {
@@ -1812,7 +3089,8 @@ propertynotify(XEvent *e)
     }
     if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
       updatetitle(c);
-      if (c == c->mon->sel && c->mon->status_idx == BAR_STATUS_WIN_TITLE)
+      ipcevent(EvTitle, "title 0x%lx %s", c->win, c->name);
+      if (c == c->mon->sel && statusshown(c->mon, BAR_STATUS_WIN_TITLE))
 	drawbar_status(c->mon);
     }
     if (ev->atom == netatom[NetWMWindowType])
@@ -1856,20 +3134,26 @@ resizeclient(Client *c, int x, int y, int w, int h)
   c->oldy = c->y; c->y = wc.y = y;
   c->oldw = c->w; c->w = wc.width = w;
   c->oldh = c->h; c->h = wc.height = h;
+  if (c->ishidden && !hideiconic) /* keep it off-screen until showhide() shows it */
+    wc.x = WIDTH(c) * -2;
   wc.border_width = c->bw;
   XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
   configure(c);
-  XSync(dpy, False);
+  ignoreenter();
 }
 
 void
 resizemouse(const Arg *arg)
 {
-  int ocx, ocy, nw, nh;
+  int ocx, ocy, nx, ny, nw, nh, moved = 0, waiting = 0;
   Client *c;
   Monitor *m;
   XEvent ev;
-  Time lasttime = 0;
+  XSyncAlarm alarm = None;
+  XSyncAlarmAttributes aa;
+  XSyncValue next;
+  Time lasttime = CurrentTime;
+  int overflow;
 
   if (!(c = selmon->sel))
     return;
@@ -1882,8 +3166,23 @@ resizemouse(const Arg *arg)
 		   None, cursor[CurResize]->cursor, CurrentTime) != GrabSuccess)
     return;
   XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
+  /* a client that takes _NET_WM_SYNC_REQUEST gets its next size only
+   * after it has painted the last one, which an alarm on its counter tells */
+  if ((aa.trigger.counter = getsynccounter(c))
+      && XSyncQueryCounter(dpy, aa.trigger.counter, &next)) {
+    XSyncIntToValue(&aa.delta, 1);
+    XSyncValueAdd(&next, next, aa.delta, &overflow);
+    aa.trigger.value_type = XSyncAbsolute;
+    aa.trigger.wait_value = next;
+    aa.trigger.test_type = XSyncPositiveComparison;
+    aa.events = True;
+    alarm = XSyncCreateAlarm(dpy, XSyncCACounter|XSyncCAValueType|XSyncCAValue
+			     |XSyncCATestType|XSyncCADelta|XSyncCAEvents, &aa);
+  }
   do {
-    XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
+    /* give up on a client that does not answer in time */
+    if (!grabevent(&ev, waiting ? (int)syncwait : -1))
+      waiting = 0;
     switch(ev.type) {
     case ConfigureRequest:
     case Expose:
@@ -1891,10 +3190,8 @@ resizemouse(const Arg *arg)
       handler[ev.type](&ev);
       break;
     case MotionNotify:
-      if ((ev.xmotion.time - lasttime) <= (1000 / 60))
-	continue;
+      compressmotion(&ev);
       lasttime = ev.xmotion.time;
-
       nw = MAX(ev.xmotion.x - ocx - 2 * c->bw + 1, 1);
       nh = MAX(ev.xmotion.y - ocy - 2 * c->bw + 1, 1);
       if (c->mon->wx + nw >= selmon->wx && c->mon->wx + nw <= selmon->wx + selmon->ww
@@ -1904,14 +3201,35 @@ resizemouse(const Arg *arg)
 	      && (abs(nw - c->w) > snap || abs(nh - c->h) > snap))
 	    togglefloating(NULL);
 	}
-      if (c->isfloating)
-	resize(c, c->x, c->y, nw, nh, 1);
+      moved = c->isfloating;
+      break;
+    default:
+      if (alarm && ev.type == syncevbase + XSyncAlarmNotify
+	  && ((XSyncAlarmNotifyEvent *)&ev)->alarm == alarm)
+	waiting = 0;
       break;
     }
+    /* the newest size waits while the client paints the one before */
+    if (moved && !waiting) {
+      nx = c->x;
+      ny = c->y;
+      if (applysizehints(c, &nx, &ny, &nw, &nh, 1)) {
+	if (alarm) {
+	  syncrequest(c, alarm, &next, lasttime);
+	  waiting = 1;
+	}
+	resizeclient(c, nx, ny, nw, nh);
+      }
+      moved = 0;
+    }
   } while (ev.type != ButtonRelease);
+  if (moved)
+    resize(c, c->x, c->y, nw, nh, 1);
+  if (alarm)
+    XSyncDestroyAlarm(dpy, alarm);
   XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
   XUngrabPointer(dpy, CurrentTime);
-  while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+  ignoreenter();
   if ((m = recttomon(c->x, c->y, c->w, c->h)) != selmon) {
     sendmon(c, m);
     selmon = m;
@@ -1923,10 +3241,9 @@ void
 restack(Monitor *m)
 {
   Client *c;
-  XEvent ev;
   XWindowChanges wc;
 
-  if (!m->sel)
+  if (!m->sel || deferred(m, PendRestack))
     return;
   if (m->sel->isfloating)
     XRaiseWindow(dpy, m->sel->win);
@@ -1939,19 +3256,116 @@ restack(Monitor *m)
 	wc.sibling = c->win;
       }
   }
-  XSync(dpy, False);
-  while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+  ignoreenter();
+}
+
+/* Put the tiled clients back where arrangemon() last placed them if
+ * nothing the layout depends on has changed since: the pane settings,
+ * div_ratio, the window area and the tiled clients of each pane in the
+ * order tile() places them, with their borders and size hints, which only
+ * count with resizehints.
+ * Returns 0 on a cache miss. */
+int
+restorelayout(Monitor *m)
+{
+  LayoutCache *lc = &m->selws->cache;
+  CachedGeom *g;
+  Client *c;
+  uint n = 0, pi;
+
+  if (!lc->valid
+      || lc->div_ratio != m->selws->div_ratio
+      || lc->wx != m->wx || lc->wy != m->wy
+      || lc->ww != m->ww || lc->wh != m->wh
+      || memcmp(lc->panes, m->selws->panes, sizeof lc->panes))
+    return 0;
+
+  for (pi = 0; pi < WS_PANES; pi++) {
+    if (!ISSHOWING(m, pi))
+      continue;
+    for (c = nexttiled(m->clients, pi); c; c = nexttiled(c->next, pi)) {
+      if (n == lc->n)
+	return 0;
+      g = &lc->geoms[n++];
+      if (g->c != c || g->win != c->win || g->pane_idx != c->pane_idx
+	  || g->bw != c->bw || (resizehints && !c->hintsvalid))
+	return 0;
+    }
+  }
+  if (n != lc->n)
+    return 0;
+
+  for (n = 0; n < lc->n; n++) {
+    g = &lc->geoms[n];
+    c = g->c;
+    c->is_arranged = 1;
+    if (c->x != g->x || c->y != g->y || c->w != g->w || c->h != g->h)
+      resizeclient(c, g->x, g->y, g->w, g->h);
+  }
+  return 1;
 }
 
 void
 run(void)
 {
   XEvent ev;
+  int warm = 1;
+  struct pollfd fds[4 + IPC_CLIENTS] = {
+    { .fd = ConnectionNumber(dpy), .events = POLLIN },
+    { .fd = drw_fontset_fd(drw), .events = POLLIN },
+    { .fd = statusthread.pipe[0], .events = POLLIN },
+    { .fd = ipcfd, .events = POLLIN },
+  };
+  uint i;
+
   /* main event loop */
   XSync(dpy, False);
-  while (running && !XNextEvent(dpy, &ev))
-    if (handler[ev.type])
-      handler[ev.type](&ev); /* call handler */
+  while (running) {
+    while (running && XPending(dpy)) {
+      XNextEvent(dpy, &ev);
+      if (handler[ev.type])
+	handler[ev.type](&ev); /* call handler */
+    }
+    if (!running)
+      break;
+    if (warm)
+      warm = drw_prewarm_step(drw, prewarmslice);
+    /* what the round changed goes out once */
+    updateclientlist();
+    updatedesktops();
+    ipcnotify();
+    /* poll() passes over the negative fds of unused slots */
+    for (i = 0; i < IPC_CLIENTS; i++) {
+      fds[4 + i].fd = ipcclients[i].fd;
+      fds[4 + i].events = POLLIN | (ipcclients[i].outlen ? POLLOUT : 0);
+    }
+    /* the requests of the round are sent before we go to sleep */
+    XFlush(dpy);
+    if (poll(fds, LENGTH(fds), warm ? 0 : statustimeout()) == -1) {
+      if (errno == EINTR)
+	continue;
+      die("poll:");
+    }
+    stats.wakeups++;
+    /* fallback fonts found for text the bars drew with placeholders */
+    if (fds[1].revents & POLLIN && drw_fontset_collect(drw)) {
+      warm = 1;
+      drawbars();
+    }
+    if (fds[2].revents & POLLIN)
+      statusupdated();
+    for (i = 0; i < IPC_CLIENTS; i++) {
+      if (ipcclients[i].fd == -1 || ipcclients[i].fd != fds[4 + i].fd)
+	continue;
+      if (fds[4 + i].revents & POLLOUT)
+	ipcflush(&ipcclients[i]);
+      if (ipcclients[i].fd != -1 && fds[4 + i].revents & (POLLIN | POLLHUP | POLLERR))
+	ipcread(&ipcclients[i]);
+    }
+    if (fds[3].revents & POLLIN)
+      ipcaccept();
+    statustick();
+  }
 }
 
 void
@@ -1981,19 +3395,66 @@ scan(void)
   }
 }
 
+int
+samesegment(const Segment *a, const Segment *b)
+{
+  return a->scheme == b->scheme && a->lpad == b->lpad && a->rpad == b->rpad
+    && !strcmp(a->text, b->text);
+}
+
 void
-sendmon(Client *c, Monitor *m)
+savelayout(Monitor *m)
 {
-  if (c->mon == m)
-    return;
-  unfocus(c, 1);
+  LayoutCache *lc = &m->selws->cache;
+  CachedGeom *g;
+  Client *c;
+  uint pi;
+
+  lc->valid = 1;
+  lc->div_ratio = m->selws->div_ratio;
+  lc->wx = m->wx;
+  lc->wy = m->wy;
+  lc->ww = m->ww;
+  lc->wh = m->wh;
+  memcpy(lc->panes, m->selws->panes, sizeof lc->panes);
+  lc->n = 0;
+  for (pi = 0; pi < WS_PANES; pi++) {
+    if (!ISSHOWING(m, pi))
+      continue;
+    for (c = nexttiled(m->clients, pi); c; c = nexttiled(c->next, pi)) {
+      if (lc->n == lc->cap) {
+	lc->cap = lc->cap ? lc->cap * 2 : 8;
+	if (!(lc->geoms = realloc(lc->geoms, lc->cap * sizeof *lc->geoms)))
+	  die("realloc:");
+      }
+      g = &lc->geoms[lc->n++];
+      g->c = c;
+      g->win = c->win;
+      g->pane_idx = c->pane_idx;
+      g->bw = c->bw;
+      g->x = c->x;
+      g->y = c->y;
+      g->w = c->w;
+      g->h = c->h;
+    }
+  }
+}
+
+void
+sendmon(Client *c, Monitor *m)
+{
+  if (c->mon == m)
+    return;
+  unfocus(c, 1);
   detach(c);
   detachstack(c);
+  detachws(c);
   drawbar(c->mon);
 
   c->mon = m;
   attach(c);
   attachstack(c);
+  attachws(c);
   focus(NULL);
   arrange(NULL);
   drawbar(m);
@@ -2030,192 +3491,787 @@ sendevent(Client *c, Atom proto)
     ev.xclient.data.l[1] = CurrentTime;
     XSendEvent(dpy, c->win, False, NoEventMask, &ev);
   }
-  return exists;
+  return exists;
+}
+
+void
+setfocus(Client *c)
+{
+  if (!c->neverfocus) {
+    XSetInputFocus(dpy, c->win, RevertToPointerRoot, CurrentTime);
+    XChangeProperty(dpy, root, netatom[NetActiveWindow],
+		    XA_WINDOW, 32, PropModeReplace,
+		    (unsigned char *) &(c->win), 1);
+  }
+  sendevent(c, wmatom[WMTakeFocus]);
+}
+
+void
+setfullscreen(Client *c, int fullscreen)
+{
+  if (fullscreen && !c->isfullscreen) {
+    c->isfullscreen = 1;
+    updatenetwmstate(c);
+    c->oldstate = c->isfloating;
+    c->oldbw = c->bw;
+    c->bw = 0;
+    c->isfloating = 1;
+    resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
+    XRaiseWindow(dpy, c->win);
+  } else if (!fullscreen && c->isfullscreen){
+    c->isfullscreen = 0;
+    updatenetwmstate(c);
+    c->isfloating = c->oldstate;
+    c->bw = c->oldbw;
+    c->x = c->oldx;
+    c->y = c->oldy;
+    c->w = c->oldw;
+    c->h = c->oldh;
+    resizeclient(c, c->x, c->y, c->w, c->h);
+    arrange(c->mon);
+  }
+}
+
+/* Iconify or restore c. Our own unmap must not reach unmapnotify(), which
+ * would take it for a withdrawal and unmanage c, so the structure events
+ * are deselected on both the client and the root window meanwhile. */
+void
+seticonic(Client *c, int iconic)
+{
+  if (iconic) {
+    XGrabServer(dpy);
+    XSelectInput(dpy, root, ROOTMASK & ~SubstructureNotifyMask);
+    XSelectInput(dpy, c->win, CLIENTMASK & ~StructureNotifyMask);
+    XUnmapWindow(dpy, c->win);
+    XSelectInput(dpy, root, ROOTMASK);
+    XSelectInput(dpy, c->win, CLIENTMASK);
+    XUngrabServer(dpy);
+    setclientstate(c, IconicState);
+  } else {
+    XMapWindow(dpy, c->win);
+    setclientstate(c, NormalState);
+  }
+  updatenetwmstate(c);
+}
+
+void
+setsegment(Segment *s, int scheme, const char *fmt, ...)
+{
+  va_list ap;
+
+  s->scheme = scheme;
+  s->lpad = s->rpad = lrpad / 2;
+  va_start(ap, fmt);
+  vsnprintf(s->text, sizeof s->text, fmt, ap);
+  va_end(ap);
+}
+
+void
+setup(void)
+{
+  int i;
+  XSetWindowAttributes wa;
+  Atom utf8string;
+  struct sigaction sa;
+
+  /* do not transform children into zombies when they terminate */
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_NOCLDSTOP | SA_NOCLDWAIT | SA_RESTART;
+  sa.sa_handler = SIG_IGN;
+  sigaction(SIGCHLD, &sa, NULL);
+
+  /* clean up any zombies (inherited from .xinitrc etc) immediately */
+  while (waitpid(-1, NULL, WNOHANG) > 0);
+
+  /* init screen */
+  screen = DefaultScreen(dpy);
+  sw = DisplayWidth(dpy, screen);
+  sh = DisplayHeight(dpy, screen);
+  root = RootWindow(dpy, screen);
+  drw = drw_create(dpy, screen, root, sw, sh);
+  if (!drw_fontset_create(drw, fonts, LENGTH(fonts)))
+    die("no fonts could be loaded.");
+  lrpad = drw->fonts->h;
+  bh = drw->fonts->h + 2;
+  prewarmbar();
+  updategeom();
+  if ((havesync = XSyncQueryExtension(dpy, &syncevbase, &syncerrbase)))
+    havesync = XSyncInitialize(dpy, &i, &i);
+  /* init atoms */
+  utf8string = XInternAtom(dpy, "UTF8_STRING", False);
+  wmatom[WMProtocols] = XInternAtom(dpy, "WM_PROTOCOLS", False);
+  wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
+  wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
+  wmatom[WMTakeFocus] = XInternAtom(dpy, "WM_TAKE_FOCUS", False);
+  netatom[NetActiveWindow] = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
+  netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
+  netatom[NetWMName] = XInternAtom(dpy, "_NET_WM_NAME", False);
+  netatom[NetWMState] = XInternAtom(dpy, "_NET_WM_STATE", False);
+  netatom[NetWMCheck] = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
+  netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
+  netatom[NetWMHidden] = XInternAtom(dpy, "_NET_WM_STATE_HIDDEN", False);
+  netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
+  netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
+  netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+  netatom[NetClientListStacking] = XInternAtom(dpy, "_NET_CLIENT_LIST_STACKING", False);
+  netatom[NetWMPid] = XInternAtom(dpy, "_NET_WM_PID", False);
+  netatom[NetNumberOfDesktops] = XInternAtom(dpy, "_NET_NUMBER_OF_DESKTOPS", False);
+  netatom[NetCurrentDesktop] = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
+  netatom[NetDesktopNames] = XInternAtom(dpy, "_NET_DESKTOP_NAMES", False);
+  netatom[NetWMDesktop] = XInternAtom(dpy, "_NET_WM_DESKTOP", False);
+  netatom[NetWorkarea] = XInternAtom(dpy, "_NET_WORKAREA", False);
+  netatom[NetWMSyncRequest] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+  netatom[NetWMSyncRequestCounter] = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER", False);
+  netatom[NetStartupId] = XInternAtom(dpy, "_NET_STARTUP_ID", False);
+  /* init cursors */
+  cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
+  cursor[CurResize] = drw_cur_create(drw, XC_sizing);
+  cursor[CurMove] = drw_cur_create(drw, XC_fleur);
+  /* init appearance */
+  scheme = ecalloc(LENGTH(colors), sizeof(Clr *));
+  for (i = 0; i < LENGTH(colors); i++)
+    scheme[i] = drw_scm_create(drw, colors[i], 3);
+  /* init bars */
+  updatebars();
+  updateedges();
+  updatestatus();
+  /* supporting window for NetWMCheck */
+  wmcheckwin = XCreateSimpleWindow(dpy, root, 0, 0, 1, 1, 0, 0, 0);
+  XChangeProperty(dpy, wmcheckwin, netatom[NetWMCheck], XA_WINDOW, 32,
+		  PropModeReplace, (unsigned char *) &wmcheckwin, 1);
+  XChangeProperty(dpy, wmcheckwin, netatom[NetWMName], utf8string, 8,
+		  PropModeReplace, (unsigned char *) WM_MY_NAME, 3);
+  XChangeProperty(dpy, root, netatom[NetWMCheck], XA_WINDOW, 32,
+		  PropModeReplace, (unsigned char *) &wmcheckwin, 1);
+  /* EWMH support per view */
+  XChangeProperty(dpy, root, netatom[NetSupported], XA_ATOM, 32,
+		  PropModeReplace, (unsigned char *) netatom, NetLast);
+  XDeleteProperty(dpy, root, netatom[NetClientList]);
+  XDeleteProperty(dpy, root, netatom[NetClientListStacking]);
+  /* a desktop is a workspace; its alternatives share the clients */
+  long ndesktops = WS_LEN;
+  XChangeProperty(dpy, root, netatom[NetNumberOfDesktops], XA_CARDINAL, 32,
+		  PropModeReplace, (unsigned char *) &ndesktops, 1);
+  char names[WS_LEN * 16];
+  size_t len = 0;
+  for (i = 0; i < WS_LEN && len < sizeof names; i++)
+    len += snprintf(names + len, sizeof names - len, "%s", wsnames[i]) + 1;
+  XChangeProperty(dpy, root, netatom[NetDesktopNames], utf8string, 8,
+		  PropModeReplace, (unsigned char *) names, MIN(len, sizeof names));
+  ewmh.current = -1;
+  /* select events */
+  wa.cursor = cursor[CurNormal]->cursor;
+  wa.event_mask = ROOTMASK;
+  XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
+  XSelectInput(dpy, root, wa.event_mask);
+  grabkeys();
+  focus(NULL);
+  statusinit();
+  ipcinit();
+}
+
+void
+seturgent(Client *c, int urg)
+{
+  XWMHints *wmh;
+
+  if (c->isurgent != urg)
+    ipcevent(EvUrgent, "urgent 0x%lx %d", c->win, urg);
+  c->isurgent = urg;
+  if (urg) c->mon->status_idx = BAR_STATUS_WORKSPACES;
+
+  if (!(wmh = XGetWMHints(dpy, c->win)))
+    return;
+  wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
+  XSetWMHints(dpy, c->win, wmh);
+  XFree(wmh);
+}
+
+void
+set_bar_status(const Arg *arg)
+{
+  if (!arg || arg->ui >= BAR_STATUS_CNT)
+    return;
+
+  selmon->status_idx = arg->ui;
+  drawbar_status(selmon);
+}
+
+/* Passes frames published to the shared status region on to the status
+ * thread. A burst of them is taken at most once per statusslack. */
+void *
+shmwatcher(void *arg)
+{
+  const struct timespec slack = { 0, statusslack * 1000000L };
+  uint32_t gen = shms_gen(statusthread.shm);
+
+  for (;;) {
+    gen = shms_wait(statusthread.shm, gen);
+    pthread_mutex_lock(&statusthread.lock);
+    if (statusthread.quit)
+      break;
+    statusthread.kick = 1;
+    pthread_cond_signal(&statusthread.cond);
+    pthread_mutex_unlock(&statusthread.lock);
+    nanosleep(&slack, NULL);
+  }
+  pthread_mutex_unlock(&statusthread.lock);
+  return NULL;
+}
+
+void
+showhide(Client *c)
+{
+  if (ISVISIBLE(c)) {
+    if (c->ishidden) {
+      c->ishidden = 0;
+      if (c->isfrozen)
+	thawpid(c->pid);
+      XMoveWindow(dpy, c->win, c->x, c->y);
+      if (hideiconic)
+	seticonic(c, 0);
+    }
+    if (c->isfloating && !c->isfullscreen)
+      resize(c, c->x, c->y, c->w, c->h, 0);
+  } else if (!c->ishidden) {
+    c->ishidden = 1;
+    c->hiddensince = nowus();
+    if (hideiconic)
+      seticonic(c, 1);
+    else
+      XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+  }
+}
+
+void
+showhidemon(Monitor *m)
+{
+  Client *c;
+
+  if (!m->stack)
+    return;
+  /* show clients top down */
+  for (c = m->stack; c; c = c->snext)
+    if (ISVISIBLE(c))
+      showhide(c);
+  /* hide clients bottom up */
+  for (c = m->stack->sprev; ; c = c->sprev) {
+    if (!ISVISIBLE(c))
+      showhide(c);
+    if (c == m->stack)
+      break;
+  }
+}
+
+/* Only touch the clients on ws_idx whose visibility differs from what
+ * showhide() last made of them. Switching workspaces calls this for the
+ * leaving and the entering workspace, so other workspaces are never
+ * visited. */
+void
+showhidews(Monitor *m, uint ws_idx)
+{
+  for (Client *c = m->wsclients[ws_idx]; c; c = c->wsnext)
+    if (ISVISIBLE(c) == c->ishidden)
+      showhide(c);
+}
+
+/* Start the command, or take a pooled instance of it, and remember
+ * where its windows should go. */
+void
+spawn(const Arg *arg)
+{
+  Workspace *ws = selmon->selws;
+  const uint64_t t0 = nowus();
+  Launch *l;
+  Window w;
+  pid_t pid;
+  size_t i;
+
+  ws->panes[ws->selpane].showing = 1;
+  if (arg->v == dmenucmd)
+    dmenumon[0] = '0' + selmon->num;
+  if ((w = pooladopt((const char **)arg->v))) {
+    stats.adopted++;
+    adoptwin = w;
+    adoptstart = t0;
+    return;
+  }
+
+  /* a free slot, or else the oldest launch */
+  for (l = launches, i = 1; i < LAUNCHES && l->pid; i++)
+    if (!launches[i].pid || launches[i].started < l->started)
+      l = &launches[i];
+  snprintf(l->id, sizeof l->id, WM_MY_NAME "-%d-%u", (int)getpid(), ++launchseq);
+  if ((pid = spawncmd((char **)arg->v, l->id)) == -1)
+    return;
+  l->pid = pid;
+  l->mon = selmon;
+  l->ws_idx = selmon->ws_idx;
+  l->pane_idx = ws->selpane;
+  l->started = t0;
+  l->mapped = 0;
+  l->win = None;
+}
+
+/* Run argv with DESKTOP_STARTUP_ID set to id, through posix_spawn(),
+ * which does not copy our page tables as fork() does. Returns its pid
+ * or -1. */
+pid_t
+spawncmd(char **argv, const char *id)
+{
+  static const char key[] = "DESKTOP_STARTUP_ID=";
+  char **env, idenv[sizeof key + 64];
+  posix_spawn_file_actions_t fa;
+  posix_spawnattr_t attr;
+  sigset_t mask;
+  pid_t pid;
+  size_t i, n;
+  int err;
+
+  snprintf(idenv, sizeof idenv, "%s%s", key, id);
+  for (n = 0; environ[n]; n++);
+  env = ecalloc(n + 2, sizeof(char *));
+  for (i = n = 0; environ[i]; i++)
+    if (strncmp(environ[i], key, sizeof key - 1))
+      env[n++] = environ[i];
+  env[n] = idenv;
+
+  posix_spawnattr_init(&attr);
+  sigemptyset(&mask);
+  posix_spawnattr_setsigmask(&attr, &mask);
+  sigaddset(&mask, SIGCHLD); /* setup() ignores it, which exec keeps */
+  posix_spawnattr_setsigdefault(&attr, &mask);
+  posix_spawnattr_setflags(&attr, SPAWN_SETSID|POSIX_SPAWN_SETSIGMASK|POSIX_SPAWN_SETSIGDEF);
+  posix_spawn_file_actions_init(&fa);
+  if (dpy)
+    posix_spawn_file_actions_addclose(&fa, ConnectionNumber(dpy));
+  if ((err = posix_spawnp(&pid, argv[0], &fa, &attr, argv, env))) {
+    fprintf(stderr, WM_MY_NAME ": spawn '%s' failed: %s\n", argv[0], strerror(err));
+    pid = -1;
+  }
+  posix_spawn_file_actions_destroy(&fa);
+  posix_spawnattr_destroy(&attr);
+  free(env);
+  return pid;
+}
+
+uint
+status_battery(Segment *segs, uint n)
+{
+  char status[16];
+  int cap;
+
+  if (si_battery(sysbattery, &cap, status, sizeof status) == -1)
+    return 0;
+  setsegment(&segs[0], cap <= 15 && strcmp(status, "Charging") ? SchemeDate3 : SchemeDate2,
+	     "%d%%", cap);
+  setsegment(&segs[1], SchemeDate1, "%s", status);
+  return 2;
+}
+
+uint
+status_command(Segment *segs, uint n, const char *cmd)
+{
+  FILE *fp = popen(cmd, "r");
+  if (!fp) {
+    fprintf(stderr, "Error popen with: %s\n", cmd);
+    return 0;
+  }
+
+  n = status_read(segs, n, fp);
+  pclose(fp);
+  return n;
+}
+
+uint
+status_cpu(Segment *segs, uint n)
+{
+  int pct;
+
+  if ((pct = si_cpu()) == -1)
+    return 0;
+  setsegment(&segs[0], pct >= 90 ? SchemeDate3 : SchemeDate2, "%d%%", pct);
+  setsegment(&segs[1], SchemeDate1, "cpu");
+  return 2;
+}
+
+uint
+status_datetime(Segment *segs, uint n, const char *label, const char *tz)
+{
+  struct tm tm;
+  char buf[20];
+
+  tz_localtime(tz_zone(tz), time(NULL), &tm);
+  setsegment(&segs[0], SchemeDate1, "%s", label);
+  strftime(buf, sizeof(buf), "%T", &tm);
+  setsegment(&segs[1], SchemeDate2, "%s", buf);
+  strftime(buf, sizeof(buf), "%a", &tm);
+  setsegment(&segs[2], SchemeDate3, "%s", buf);
+  strftime(buf, sizeof(buf), "%F", &tm);
+  setsegment(&segs[3], SchemeDate4, "%s", buf);
+  return 4;
+}
+
+uint
+status_disk(Segment *segs, uint n)
+{
+  SysDisk disk;
+  char buf[16];
+
+  if (si_disk(sysdisk, &disk) == -1)
+    return 0;
+  fmtbytes(buf, sizeof buf, disk.avail);
+  setsegment(&segs[0], SchemeDate2, "%s", buf);
+  setsegment(&segs[1], SchemeDate1, "%s", sysdisk);
+  return 2;
+}
+
+uint
+status_file(Segment *segs, uint n, const char *path)
+{
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    fprintf(stderr, "Error fopen with: %s\n", path);
+    return 0;
+  }
+
+  n = status_read(segs, n, fp);
+  fclose(fp);
+  return n;
+}
+
+uint
+status_load(Segment *segs, uint n)
+{
+  double load[3];
+
+  if (si_load(load) == -1)
+    return 0;
+  setsegment(&segs[0], SchemeDate2, "%.2f %.2f %.2f", load[0], load[1], load[2]);
+  setsegment(&segs[1], SchemeDate1, "load");
+  return 2;
+}
+
+uint
+status_mem(Segment *segs, uint n)
+{
+  SysMem mem;
+  char buf[16];
+
+  if (si_mem(&mem) == -1)
+    return 0;
+  fmtbytes(buf, sizeof buf, (mem.total - mem.avail) * 1024.0);
+  setsegment(&segs[0], SchemeDate2, "%s", buf);
+  setsegment(&segs[1], SchemeDate1, "mem");
+  return 2;
+}
+
+uint
+status_net(Segment *segs, uint n)
+{
+  SysNet net;
+  char buf[16];
+
+  if (si_net(sysnetiface, &net) == -1)
+    return 0;
+  fmtbytes(buf, sizeof buf, net.tx);
+  setsegment(&segs[0], SchemeDate2, "+%s", buf);
+  fmtbytes(buf, sizeof buf, net.rx);
+  setsegment(&segs[1], SchemeDate4, "-%s", buf);
+  setsegment(&segs[2], SchemeDate1, "%s", sysnetiface);
+  return 3;
+}
+
+/* lines of scheme<TAB>pad<TAB>text, the first one drawn rightmost */
+uint
+status_read(Segment *segs, uint n, FILE *fp)
+{
+  uint i = 0;
+  char buf[300], *p, *sp;
+  while (i < n && fgets(buf, sizeof buf, fp) != 0) {
+    p = strtok_r(buf, "\t", &sp);
+    if (p == NULL) continue;
+    long si = strtol(p, NULL, 10);
+    if (si < 0 || si > SCHEME_MAX) si = 0;
+
+    p = strtok_r(NULL, "\t", &sp);
+    if (p == NULL) continue;
+    long pad = strtol(p, NULL, 10);
+    if (pad < 0 || pad > 20) pad = 0;
+
+    p = strtok_r(NULL, "\n", &sp);
+    if (p == NULL) continue;
+
+    segs[i].scheme = si;
+    segs[i].lpad = 0;
+    segs[i].rpad = pad;
+    snprintf(segs[i].text, sizeof segs[i].text, "%s", p);
+    i++;
+  }
+  return i;
 }
 
-void
-setfocus(Client *c)
+/* the latest frame of a slot of the shared status region, no system call
+ * unless a producer is writing it right now */
+uint
+status_shm(Segment *segs, uint n, uint slot)
 {
-  if (!c->neverfocus) {
-    XSetInputFocus(dpy, c->win, RevertToPointerRoot, CurrentTime);
-    XChangeProperty(dpy, root, netatom[NetActiveWindow],
-		    XA_WINDOW, 32, PropModeReplace,
-		    (unsigned char *) &(c->win), 1);
+  ShmSeg frame[SHMS_SEGS];
+  int i, m;
+
+  if (!statusthread.shm
+      || (m = shms_read(statusthread.shm, slot, frame, MIN(n, SHMS_SEGS))) == -1)
+    return 0;
+  for (i = 0; i < m; i++) {
+    segs[i].scheme = frame[i].scheme < 0 || frame[i].scheme > SCHEME_MAX ? 0 : frame[i].scheme;
+    segs[i].lpad = 0;
+    segs[i].rpad = frame[i].pad < 0 || frame[i].pad > 20 ? 0 : frame[i].pad;
+    snprintf(segs[i].text, sizeof segs[i].text, "%s", frame[i].text);
   }
-  sendevent(c, wmatom[WMTakeFocus]);
+  return m;
 }
 
-void
-setfullscreen(Client *c, int fullscreen)
+uint
+status_thermal(Segment *segs, uint n)
 {
-  if (fullscreen && !c->isfullscreen) {
-    XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
-		    PropModeReplace, (unsigned char*)&netatom[NetWMFullscreen], 1);
-    c->isfullscreen = 1;
-    c->oldstate = c->isfloating;
-    c->oldbw = c->bw;
-    c->bw = 0;
-    c->isfloating = 1;
-    resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
-    XRaiseWindow(dpy, c->win);
-  } else if (!fullscreen && c->isfullscreen){
-    XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
-		    PropModeReplace, (unsigned char*)0, 0);
-    c->isfullscreen = 0;
-    c->isfloating = c->oldstate;
-    c->bw = c->oldbw;
-    c->x = c->oldx;
-    c->y = c->oldy;
-    c->w = c->oldw;
-    c->h = c->oldh;
-    resizeclient(c, c->x, c->y, c->w, c->h);
-    arrange(c->mon);
-  }
+  int temp;
+
+  if ((temp = si_thermal(systhermal)) == -1)
+    return 0;
+  setsegment(&segs[0], temp >= 80 ? SchemeDate3 : SchemeDate2, "%d°C", temp);
+  setsegment(&segs[1], SchemeDate1, "temp");
+  return 2;
 }
 
 void
-setup(void)
+statuscleanup(void)
 {
-  int i;
-  XSetWindowAttributes wa;
-  Atom utf8string;
-  struct sigaction sa;
-
-  /* do not transform children into zombies when they terminate */
-  sigemptyset(&sa.sa_mask);
-  sa.sa_flags = SA_NOCLDSTOP | SA_NOCLDWAIT | SA_RESTART;
-  sa.sa_handler = SIG_IGN;
-  sigaction(SIGCHLD, &sa, NULL);
-
-  /* clean up any zombies (inherited from .xinitrc etc) immediately */
-  while (waitpid(-1, NULL, WNOHANG) > 0);
+  pthread_mutex_lock(&statusthread.lock);
+  statusthread.quit = 1;
+  pthread_cond_signal(&statusthread.cond);
+  pthread_mutex_unlock(&statusthread.lock);
+  pthread_join(statusthread.thread, NULL);
+  if (statusthread.shm) {
+    shms_wake(statusthread.shm);
+    pthread_join(statusthread.watcher, NULL);
+    shms_close(statusthread.shm);
+  }
+  close(statusthread.pipe[0]);
+  close(statusthread.pipe[1]);
+  pthread_cond_destroy(&statusthread.cond);
+  pthread_mutex_destroy(&statusthread.lock);
+}
 
-  /* init screen */
-  screen = DefaultScreen(dpy);
-  sw = DisplayWidth(dpy, screen);
-  sh = DisplayHeight(dpy, screen);
-  root = RootWindow(dpy, screen);
-  drw = drw_create(dpy, screen, root, sw, sh);
-  if (!drw_fontset_create(drw, fonts, LENGTH(fonts)))
-    die("no fonts could be loaded.");
-  lrpad = drw->fonts->h;
-  bh = drw->fonts->h + 2;
-  updategeom();
-  /* init atoms */
-  utf8string = XInternAtom(dpy, "UTF8_STRING", False);
-  wmatom[WMProtocols] = XInternAtom(dpy, "WM_PROTOCOLS", False);
-  wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
-  wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
-  wmatom[WMTakeFocus] = XInternAtom(dpy, "WM_TAKE_FOCUS", False);
-  netatom[NetActiveWindow] = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
-  netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
-  netatom[NetWMName] = XInternAtom(dpy, "_NET_WM_NAME", False);
-  netatom[NetWMState] = XInternAtom(dpy, "_NET_WM_STATE", False);
-  netatom[NetWMCheck] = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
-  netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
-  netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
-  netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
-  netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
-  /* init cursors */
-  cursor[CurNormal] = drw_cur_create(drw, XC_left_ptr);
-  cursor[CurResize] = drw_cur_create(drw, XC_sizing);
-  cursor[CurMove] = drw_cur_create(drw, XC_fleur);
-  /* init appearance */
-  scheme = ecalloc(LENGTH(colors), sizeof(Clr *));
-  for (i = 0; i < LENGTH(colors); i++)
-    scheme[i] = drw_scm_create(drw, colors[i], 3);
-  /* init bars */
-  updatebars();
-  updatestatus();
-  /* supporting window for NetWMCheck */
-  wmcheckwin = XCreateSimpleWindow(dpy, root, 0, 0, 1, 1, 0, 0, 0);
-  XChangeProperty(dpy, wmcheckwin, netatom[NetWMCheck], XA_WINDOW, 32,
-		  PropModeReplace, (unsigned char *) &wmcheckwin, 1);
-  XChangeProperty(dpy, wmcheckwin, netatom[NetWMName], utf8string, 8,
-		  PropModeReplace, (unsigned char *) WM_MY_NAME, 3);
-  XChangeProperty(dpy, root, netatom[NetWMCheck], XA_WINDOW, 32,
-		  PropModeReplace, (unsigned char *) &wmcheckwin, 1);
-  /* EWMH support per view */
-  XChangeProperty(dpy, root, netatom[NetSupported], XA_ATOM, 32,
-		  PropModeReplace, (unsigned char *) netatom, NetLast);
-  XDeleteProperty(dpy, root, netatom[NetClientList]);
-  /* select events */
-  wa.cursor = cursor[CurNormal]->cursor;
-  wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask
-    |ButtonPressMask|PointerMotionMask|EnterWindowMask
-    |LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
-  XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
-  XSelectInput(dpy, root, wa.event_mask);
-  grabkeys();
-  focus(NULL);
+/* The run after the one due at due. Intervals of whole seconds tick on
+ * the wall clock second, the others keep their phase; a run that fell
+ * behind is not caught up on. */
+uint64_t
+statusdue(uint64_t due, uint interval, uint64_t now)
+{
+  uint64_t iv = MAX(interval, statusslack) * 1000ULL, real, next;
+  struct timespec ts;
+
+  if (due < now)
+    due = now;
+  if (iv % 1000000)
+    return due + iv;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  real = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000 + (due - now);
+  next = due + iv - real % iv;
+  return next - due < iv / 2 ? next + iv : next;
 }
 
 void
-seturgent(Client *c, int urg)
+statusinit(void)
 {
-  XWMHints *wmh;
-
-  c->isurgent = urg;
-  if (urg) c->mon->status_idx = BAR_STATUS_WORKSPACES;
+  pthread_condattr_t attr;
+
+  if (pipe(statusthread.pipe) == -1)
+    die("pipe:");
+  fcntl(statusthread.pipe[0], F_SETFD, FD_CLOEXEC);
+  fcntl(statusthread.pipe[1], F_SETFD, FD_CLOEXEC);
+  fcntl(statusthread.pipe[0], F_SETFL, O_NONBLOCK);
+  fcntl(statusthread.pipe[1], F_SETFL, O_NONBLOCK);
+  pthread_mutex_init(&statusthread.lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&statusthread.cond, &attr);
+  pthread_condattr_destroy(&attr);
+  housekeepdue = nowus();
+  if (pthread_create(&statusthread.thread, NULL, statusworker, NULL) != 0)
+    die("pthread_create:");
+  if (!(statusthread.shm = shms_open(NULL, 1)))
+    fprintf(stderr, "dzwm: no shared status region: %s\n", strerror(errno));
+  else if (pthread_create(&statusthread.watcher, NULL, shmwatcher, NULL) != 0)
+    die("pthread_create:");
+}
 
-  if (!(wmh = XGetWMHints(dpy, c->win)))
-    return;
-  wmh->flags = urg ? (wmh->flags | XUrgencyHint) : (wmh->flags & ~XUrgencyHint);
-  XSetWMHints(dpy, c->win, wmh);
-  XFree(wmh);
+int
+statusshown(Monitor *m, uint i)
+{
+  return m->status_idx == i || (i < BAR_STATUS_CNT && m->pinned[i]);
 }
 
+/* redraw the bars whose timed render is due, and run the housekeeping */
 void
-set_bar_status(const Arg *arg)
+statustick(void)
 {
-  if (!arg || arg->ui >= BAR_STATUS_CNT)
-    return;
+  const uint64_t now = nowus(), slack = statusslack * 1000ULL;
+  const StatusRenderSpec *s;
+  Monitor *m;
+  uint i;
 
-  selmon->status_idx = arg->ui;
-  selmon->last_status_render = 0;
-  drawbar_status(selmon);
+  for (i = 0; i < BAR_STATUS_CNT; i++) {
+    s = &statusrenderspecs[i];
+    if (!s->render || !s->interval || renderdue[i] > now + slack)
+      continue;
+    for (m = mons; m; m = m->next)
+      if (statusshown(m, i))
+	drawbar_status(m);
+    renderdue[i] = statusdue(renderdue[i], s->interval, now);
+  }
+  if (housekeepdue <= now + slack) {
+    freezeclients();
+    pooltick();
+    housekeepdue = statusdue(housekeepdue, 1000, now);
+  }
 }
 
-void
-showhide(Client *c)
+/* milliseconds until statustick() has something to do */
+int
+statustimeout(void)
 {
-  if (!c)
-    return;
-  if (ISVISIBLE(c)) {
-    /* show clients top down */
-    XMoveWindow(dpy, c->win, c->x, c->y);
-    if (c->isfloating && !c->isfullscreen)
-      resize(c, c->x, c->y, c->w, c->h, 0);
-    showhide(c->snext);
-  } else {
-    /* hide clients bottom up */
-    showhide(c->snext);
-    XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+  const uint64_t now = nowus();
+  uint64_t next = housekeepdue;
+  const StatusRenderSpec *s;
+  Monitor *m;
+  uint i;
+
+  for (i = 0; i < BAR_STATUS_CNT; i++) {
+    s = &statusrenderspecs[i];
+    if (!s->render || !s->interval)
+      continue;
+    for (m = mons; m; m = m->next)
+      if (m->showbar && statusshown(m, i))
+	next = MIN(next, renderdue[i]);
   }
+  return next <= now ? 0 : (next - now + 999) / 1000;
 }
 
+/* show what the status thread produced on the bars displaying it */
 void
-spawn(const Arg *arg)
+statusupdated(void)
 {
-  Workspace *ws = selmon->selws;
-  ws->panes[ws->selpane].showing = 1;
+  int dirty[BAR_STATUS_CNT];
+  char buf[64];
+  Monitor *m;
+  uint i;
 
-  struct sigaction sa;
+  while (read(statusthread.pipe[0], buf, sizeof buf) > 0);
+  pthread_mutex_lock(&statusthread.lock);
+  for (i = 0; i < BAR_STATUS_CNT; i++) {
+    dirty[i] = statusbufs[i].dirty;
+    statusbufs[i].dirty = 0;
+  }
+  pthread_mutex_unlock(&statusthread.lock);
+  for (m = mons; m; m = m->next)
+    for (i = 0; i < BAR_STATUS_CNT; i++)
+      if (dirty[i] && statusshown(m, i)) {
+	drawbar_status(m);
+	break;
+      }
+}
 
-  if (arg->v == dmenucmd)
-    dmenumon[0] = '0' + selmon->num;
-  if (fork() == 0) {
-    if (dpy)
-      close(ConnectionNumber(dpy));
-    setsid();
+/* Runs the update of every status module when due, shown or not. Runs
+ * due within statusslack of each other share a wakeup. */
+void *
+statusworker(void *arg)
+{
+  Segment segs[STATUS_SEGS];
+  StatusBuf *b;
+  struct timespec ts;
+  uint64_t now, next;
+  uint i, n, j, iv;
+  int changed, kick;
+
+  pthread_mutex_lock(&statusthread.lock);
+  while (!statusthread.quit) {
+    kick = statusthread.kick;
+    statusthread.kick = 0;
+    pthread_mutex_unlock(&statusthread.lock);
+    changed = 0;
+    now = nowus();
+    next = UINT64_MAX;
+    for (i = 0; i < BAR_STATUS_CNT; i++) {
+      if (!statusrenderspecs[i].update)
+	continue;
+      b = &statusbufs[i];
+      iv = statusrenderspecs[i].interval;
+      /* no interval: run once, then whenever a producer published */
+      if (iv ? b->due <= now + statusslack * 1000ULL : kick || !b->due) {
+	n = statusrenderspecs[i].update(segs, LENGTH(segs));
+	pthread_mutex_lock(&statusthread.lock);
+	for (j = 0; j < n && j < b->n && samesegment(&segs[j], &b->segs[j]); j++);
+	if (j < n || n != b->n) {
+	  memcpy(b->segs, segs, n * sizeof(Segment));
+	  b->n = n;
+	  b->dirty = changed = 1;
+	}
+	pthread_mutex_unlock(&statusthread.lock);
+	b->due = iv ? statusdue(b->due, iv, now) : UINT64_MAX;
+      }
+      next = MIN(next, b->due);
+    }
+    if (changed && write(statusthread.pipe[1], "", 1) == -1) {
+      /* the pipe is full, a wakeup is pending anyway */
+    }
+
+    pthread_mutex_lock(&statusthread.lock);
+    if (statusthread.quit)
+      break;
+    if (statusthread.kick)
+      continue;
+    if (next == UINT64_MAX) {
+      pthread_cond_wait(&statusthread.cond, &statusthread.lock);
+    } else {
+      ts.tv_sec = next / 1000000;
+      ts.tv_nsec = next % 1000000 * 1000;
+      pthread_cond_timedwait(&statusthread.cond, &statusthread.lock, &ts);
+    }
+  }
+  pthread_mutex_unlock(&statusthread.lock);
+  return NULL;
+}
 
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sa.sa_handler = SIG_DFL;
-    sigaction(SIGCHLD, &sa, NULL);
+/* exchange the positions of a and b in their monitor's client list */
+void
+swapclients(Client *a, Client *b)
+{
+  Client *an;
 
-    execvp(((char **)arg->v)[0], (char **)arg->v);
-    die(WM_MY_NAME ": execvp '%s' failed:", ((char **)arg->v)[0]);
+  if (a == b)
+    return;
+  if (a->next == b) {
+    detach(b);
+    attachbefore(b, a);
+  } else if (b->next == a) {
+    detach(a);
+    attachbefore(a, b);
+  } else {
+    an = a->next;
+    detach(a);
+    attachbefore(a, b);
+    detach(b);
+    if (an)
+      attachbefore(b, an);
+    else {
+      /* a was the tail, b takes its place */
+      an = b->mon->clients;
+      b->next = NULL;
+      b->prev = an->prev;
+      an->prev->next = b;
+      an->prev = b;
+    }
   }
 }
 
@@ -2236,17 +4292,114 @@ switchworkspace(const Arg *arg)
     alt_idx = selmon->last_alt_idx;
   }
 
+  const uint old_ws_idx = selmon->ws_idx;
   selmon->last_ws_idx = selmon->ws_idx;
   selmon->last_alt_idx = selmon->alt_idx;
   selmon->ws_idx = ws_idx;
   selmon->alt_idx = alt_idx;
   selmon->selws = &selmon->workspaces[ws_idx][alt_idx];
 
+  if (deferred(selmon, PendArrange | PendBar)) {
+    focus(NULL);
+    return;
+  }
+  /* map the clients before one of them gets the input focus */
+  showhidews(selmon, ws_idx);
+  if (old_ws_idx != ws_idx)
+    showhidews(selmon, old_ws_idx);
+  arrangemon(selmon);
   focus(NULL);
-  arrange(selmon);
+  restack(selmon);
   drawbar(selmon);
 }
 
+/* ask c to set its sync counter to *v once it has painted the size it
+ * is about to get, arm alarm for that and step *v to the next value */
+void
+syncrequest(Client *c, XSyncAlarm alarm, XSyncValue *v, Time t)
+{
+  XSyncAlarmAttributes aa;
+  XSyncValue one;
+  XEvent ev;
+  int overflow;
+
+  aa.trigger.wait_value = *v;
+  XSyncChangeAlarm(dpy, alarm, XSyncCAValue, &aa);
+  ev.type = ClientMessage;
+  ev.xclient.window = c->win;
+  ev.xclient.message_type = wmatom[WMProtocols];
+  ev.xclient.format = 32;
+  ev.xclient.data.l[0] = netatom[NetWMSyncRequest];
+  ev.xclient.data.l[1] = t;
+  ev.xclient.data.l[2] = XSyncValueLow32(*v);
+  ev.xclient.data.l[3] = XSyncValueHigh32(*v);
+  ev.xclient.data.l[4] = 0;
+  XSendEvent(dpy, c->win, False, NoEventMask, &ev);
+  XSyncIntToValue(&one, 1);
+  XSyncValueAdd(v, *v, one, &overflow);
+}
+
+/* Take the auto-repeats of ev's key queued right behind it off the queue
+ * and count them: presses of the same key and modifiers, each maybe
+ * after a release with its time, as servers without detectable
+ * auto-repeat send them. */
+uint
+takerepeats(XKeyEvent *ev)
+{
+  XEvent next, press;
+  uint n = 0;
+
+  while (XEventsQueued(dpy, QueuedAfterReading)) {
+    XPeekEvent(dpy, &next);
+    if ((next.type != KeyPress && next.type != KeyRelease)
+	|| next.xkey.keycode != ev->keycode || next.xkey.state != ev->state)
+      break;
+    if (next.type == KeyRelease) {
+      XNextEvent(dpy, &next);
+      if (!XEventsQueued(dpy, QueuedAfterReading)
+	  || (XPeekEvent(dpy, &press), press.type != KeyPress)
+	  || press.xkey.keycode != ev->keycode || press.xkey.time != next.xkey.time) {
+	XPutBackEvent(dpy, &next); /* the key really went up */
+	break;
+      }
+    }
+    XNextEvent(dpy, &next);
+    n++;
+  }
+  return n;
+}
+
+/* resume what freezepid() stopped and record how long that took */
+void
+thawpid(pid_t pid)
+{
+  Freezer **fp, *f;
+  Monitor *m;
+  Client *c;
+  uint64_t t0 = nowus();
+
+  for (fp = &freezers; *fp && (*fp)->pid != pid; fp = &(*fp)->next);
+  if ((f = *fp)) {
+    *fp = f->next;
+    if (f->cgfreeze[0])
+      writefile(f->cgfreeze, "0");
+    else
+      while (f->ntree--)
+	kill(f->tree[f->ntree], SIGCONT);
+    free(f->tree);
+    free(f);
+    stats.frozen--;
+  }
+  for (m = mons; m; m = m->next)
+    for (c = m->clients; c; c = c->next)
+      if (c->pid == pid)
+	c->isfrozen = 0;
+
+  stats.thaws++;
+  stats.thaw_last_us = nowus() - t0;
+  stats.thaw_max_us = MAX(stats.thaw_max_us, stats.thaw_last_us);
+}
+
 void
 tile(Monitor *m, uint pi, Rect *r, int vert)
 {
@@ -2320,11 +4473,10 @@ togglepane(const Arg *arg)
   const uint pi = arg->ui == 0 ? selmon->selws->selpane : arg->ui - 1;
   if (pi >= WS_PANES) return;
 
+  Client *c = NULL;
   if (selmon->selws->panes[pi].showing ^= 1) {
-    Client *c = selmon->stack;
+    c = selmon->stack;
     for (; c && !(ISCURRENTWS(c) && c->pane_idx == pi); c = c->snext);
-    if (c)
-      focus(c);
   } else {
     if (selmon->sel && selmon->sel->pane_idx == pi) {
       focus(NULL);
@@ -2332,6 +4484,9 @@ togglepane(const Arg *arg)
   }
 
   arrange(selmon);
+  /* c is mapped by now and can take the input focus */
+  if (c)
+    focus(c);
   drawbar(selmon);
 }
 
@@ -2354,8 +4509,11 @@ unmanage(Client *c, int destroyed)
   Monitor *m = c->mon;
   XWindowChanges wc;
 
+  if (c->isfrozen)
+    thawpid(c->pid);
   detach(c);
   detachstack(c);
+  detachws(c);
   if (!destroyed) {
     wc.border_width = c->oldbw;
     XGrabServer(dpy); /* avoid race conditions */
@@ -2368,9 +4526,9 @@ unmanage(Client *c, int destroyed)
     XSetErrorHandler(xerror);
     XUngrabServer(dpy);
   }
+  ipcevent(EvRemove, "remove 0x%lx", c->win);
   free(c);
   focus(NULL);
-  updateclientlist();
   arrange(m);
   drawbar(m);
 }
@@ -2382,9 +4540,9 @@ unmapnotify(XEvent *e)
   XUnmapEvent *ev = &e->xunmap;
 
   if ((c = wintoclient(ev->window))) {
-    if (ev->send_event)
+    if (ev->send_event && !(c->ishidden && hideiconic))
       setclientstate(c, WithdrawnState);
-    else
+    else /* an iconified client can only withdraw by the synthetic event */
       unmanage(c, 0);
   }
 }
@@ -2424,18 +4582,142 @@ updatebarpos(Monitor *m)
     m->by = -bh;
 }
 
+/* Set _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING, each in one
+ * request and only when it changed. */
 void
 updateclientlist(void)
 {
   Client *c;
   Monitor *m;
+  uint n = 0, i;
+  int same;
 
-  XDeleteProperty(dpy, root, netatom[NetClientList]);
   for (m = mons; m; m = m->next)
     for (c = m->clients; c; c = c->next)
-      XChangeProperty(dpy, root, netatom[NetClientList],
-		      XA_WINDOW, 32, PropModeAppend,
-		      (unsigned char *) &(c->win), 1);
+      n++;
+  if (n > ewmh.cap) {
+    ewmh.cap = MAX(n, 2 * ewmh.cap);
+    free(ewmh.clients);
+    free(ewmh.stacking);
+    ewmh.clients = ecalloc(ewmh.cap, sizeof(Window));
+    ewmh.stacking = ecalloc(ewmh.cap, sizeof(Window));
+  }
+
+  same = n == ewmh.nclients;
+  for (i = 0, m = mons; m; m = m->next)
+    for (c = m->clients; c; c = c->next, i++)
+      if (ewmh.clients[i] != c->win) {
+	same = 0;
+	ewmh.clients[i] = c->win;
+      }
+  if (!same) {
+    ewmh.nclients = n;
+    XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32,
+		    PropModeReplace, (unsigned char *) ewmh.clients, n);
+  }
+
+  /* bottom to top, the focus stack the other way round */
+  same = n == ewmh.nstacking;
+  for (i = n, m = mons; m; m = m->next)
+    for (c = m->stack; c; c = c->snext)
+      if (ewmh.stacking[--i] != c->win) {
+	same = 0;
+	ewmh.stacking[i] = c->win;
+      }
+  if (!same) {
+    ewmh.nstacking = n;
+    XChangeProperty(dpy, root, netatom[NetClientListStacking], XA_WINDOW, 32,
+		    PropModeReplace, (unsigned char *) ewmh.stacking, n);
+  }
+}
+
+/* Set the current desktop, the work area and the desktop of each client
+ * where they changed. */
+void
+updatedesktops(void)
+{
+  long workarea[4 * WS_LEN], desktop;
+  Client *c;
+  Monitor *m;
+  uint i;
+
+  if (selmon && selmon->ws_idx != ewmh.current) {
+    ewmh.current = selmon->ws_idx;
+    XChangeProperty(dpy, root, netatom[NetCurrentDesktop], XA_CARDINAL, 32,
+		    PropModeReplace, (unsigned char *) &ewmh.current, 1);
+  }
+  if (mons && (mons->wx != ewmh.workarea[0] || mons->wy != ewmh.workarea[1]
+	       || mons->ww != ewmh.workarea[2] || mons->wh != ewmh.workarea[3])) {
+    ewmh.workarea[0] = mons->wx;
+    ewmh.workarea[1] = mons->wy;
+    ewmh.workarea[2] = mons->ww;
+    ewmh.workarea[3] = mons->wh;
+    for (i = 0; i < WS_LEN; i++)
+      memcpy(&workarea[4 * i], ewmh.workarea, sizeof ewmh.workarea);
+    XChangeProperty(dpy, root, netatom[NetWorkarea], XA_CARDINAL, 32,
+		    PropModeReplace, (unsigned char *) workarea, LENGTH(workarea));
+  }
+  for (m = mons; m; m = m->next)
+    for (c = m->clients; c; c = c->next)
+      if (c->desktop != c->ws_idx + 1) {
+	c->desktop = c->ws_idx + 1;
+	desktop = c->ws_idx;
+	XChangeProperty(dpy, c->win, netatom[NetWMDesktop], XA_CARDINAL, 32,
+			PropModeReplace, (unsigned char *) &desktop, 1);
+      }
+}
+
+/* Every monitor is covered by an InputOnly window kept below all the
+ * clients. The pointer passing from one monitor to another over the
+ * bare root window crosses from one of them into the next, and
+ * enternotify() moves selmon, without any motion events on root. */
+/* Give each monitor InputOnly strips edgepx wide along the left, right,
+ * top and bottom sides it shares with another monitor, below the
+ * clients. A pointer crossing the bare desktop to another monitor enters
+ * the far strip, or leaves the near one for root, and enternotify()
+ * moves selmon. With a strip on both sides of the border a pointer has
+ * to jump 2 * edgepx to get past unseen, and then the next client it
+ * enters or the next click on root catches up. The rest of the desktop
+ * is root itself, so XQueryPointer() and drag and drop targets see no
+ * window of ours there. */
+void
+updateedges(void)
+{
+  Monitor *m, *n;
+  XSetWindowAttributes wa = {
+    .override_redirect = True,
+    .event_mask = EnterWindowMask
+  };
+  int i, x, y, w, h;
+
+  for (m = mons; m; m = m->next)
+    for (i = 0; i < 4; i++) {
+      for (n = mons; n; n = n->next)
+	if (n != m && (i < 2
+		       ? n->my < m->my + m->mh && m->my < n->my + n->mh
+			 && (i ? n->mx == m->mx + m->mw : n->mx + n->mw == m->mx)
+		       : n->mx < m->mx + m->mw && m->mx < n->mx + n->mw
+			 && (i == 3 ? n->my == m->my + m->mh : n->my + n->mh == m->my)))
+	  break;
+      if (!n) {
+	if (m->edgewins[i])
+	  XDestroyWindow(dpy, m->edgewins[i]);
+	m->edgewins[i] = None;
+	continue;
+      }
+      x = i == 1 ? m->mx + m->mw - (int)edgepx : m->mx;
+      y = i == 3 ? m->my + m->mh - (int)edgepx : m->my;
+      w = i < 2 ? (int)edgepx : m->mw;
+      h = i < 2 ? m->mh : (int)edgepx;
+      if (!m->edgewins[i]) {
+	m->edgewins[i] = XCreateWindow(dpy, root, x, y, w, h, 0, 0, InputOnly,
+				       CopyFromParent, CWOverrideRedirect|CWEventMask, &wa);
+	XDefineCursor(dpy, m->edgewins[i], cursor[CurNormal]->cursor);
+	XMapWindow(dpy, m->edgewins[i]);
+      } else
+	XMoveResizeWindow(dpy, m->edgewins[i], x, y, w, h);
+      XLowerWindow(dpy, m->edgewins[i]);
+    }
 }
 
 int
@@ -2486,11 +4768,13 @@ updategeom(void)
       for (m = mons; m && m->next; m = m->next);
       while ((c = m->clients)) {
 	dirty = 1;
-	m->clients = c->next;
+	detach(c);
 	detachstack(c);
+	detachws(c);
 	c->mon = mons;
 	attach(c);
 	attachstack(c);
+	attachws(c);
       }
       if (m == selmon)
 	selmon = mons;
@@ -2516,6 +4800,20 @@ updategeom(void)
   return dirty;
 }
 
+void
+updatenetwmstate(Client *c)
+{
+  Atom state[2];
+  int n = 0;
+
+  if (c->isfullscreen)
+    state[n++] = netatom[NetWMFullscreen];
+  if (c->ishidden && hideiconic)
+    state[n++] = netatom[NetWMHidden];
+  XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
+		  PropModeReplace, (unsigned char *)state, n);
+}
+
 void
 updatenumlockmask(void)
 {
@@ -2580,8 +4878,11 @@ void
 updatestatus(void)
 {
   for (Monitor *m = mons; m; m = m->next)
-    if (m->status_idx >= BAR_STATUS_CUSTOM)
-      drawbar_status(m);
+    for (uint i = BAR_STATUS_CUSTOM; i < BAR_STATUS_CNT; i++)
+      if (statusshown(m, i)) {
+	drawbar_status(m);
+	break;
+      }
 }
 
 void
@@ -2615,6 +4916,8 @@ updatewmhints(Client *c)
       wmh->flags &= ~XUrgencyHint;
       XSetWMHints(dpy, c->win, wmh);
     } else {
+      if (c->isurgent != !!(wmh->flags & XUrgencyHint))
+	ipcevent(EvUrgent, "urgent 0x%lx %d", c->win, !c->isurgent);
       c->isurgent = (wmh->flags & XUrgencyHint) ? 1 : 0;
       if (c->isurgent) c->mon->status_idx = BAR_STATUS_WORKSPACES;
     }
@@ -2649,7 +4952,8 @@ wintomon(Window w)
   if (w == root && getrootptr(&x, &y))
     return recttomon(x, y, 1, 1);
   for (m = mons; m; m = m->next)
-    if (w == m->barwin)
+    if (w == m->barwin || w == m->edgewins[0] || w == m->edgewins[1]
+	|| w == m->edgewins[2] || w == m->edgewins[3])
       return m;
   if ((c = wintoclient(w)))
     return c->mon;
@@ -2670,7 +4974,10 @@ xerror(Display *dpy, XErrorEvent *ee)
       || (ee->request_code == X_ConfigureWindow && ee->error_code == BadMatch)
       || (ee->request_code == X_GrabButton && ee->error_code == BadAccess)
       || (ee->request_code == X_GrabKey && ee->error_code == BadAccess)
-      || (ee->request_code == X_CopyArea && ee->error_code == BadDrawable))
+      || (ee->request_code == X_CopyArea && ee->error_code == BadDrawable)
+      /* a client's sync counter may be bogus or gone */
+      || (havesync && (ee->error_code == syncerrbase + XSyncBadCounter
+		       || ee->error_code == syncerrbase + XSyncBadAlarm)))
     return 0;
   fprintf(stderr, WM_MY_NAME ": fatal error: request code=%d, error code=%d\n",
 	  ee->request_code, ee->error_code);
@@ -2704,17 +5011,6 @@ zoom(const Arg *arg)
   pop(c);
 }
 
-void*
-timer_loop(void* v)
-{
-  struct timespec ts = {.tv_sec = 1, .tv_nsec = 0};
-  do {
-    XStoreName(dpy, root, "");
-    XFlush(dpy);
-  } while (nanosleep(&ts, NULL) == 0);
-  return NULL;
-}
-
 int
 main(int argc, char *argv[])
 {
@@ -2729,16 +5025,11 @@ main(int argc, char *argv[])
   checkotherwm();
   setup();
 #ifdef __OpenBSD__
-  if (pledge("stdio rpath proc exec", NULL) == -1)
+  if (pledge("stdio rpath cpath unix proc exec", NULL) == -1)
     die("pledge");
 #endif /* __OpenBSD__ */
   scan();
-
-  pthread_t timer;
-  pthread_create(&timer, NULL, timer_loop, NULL);
   run();
-  pthread_kill(timer, SIGUSR1);
-
   cleanup();
   XCloseDisplay(dpy);
   return EXIT_SUCCESS;
@@ -0,0 +1,131 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dzwmc sends commands to dzwm over its socket and prints the replies.
+ * The arguments make up one line; without arguments every line of
+ * standard input is sent. Commands separated by ';' on one line are
+ * applied together, with one arrange and redraw at the end:
+ *
+ *   dzwmc 'switchworkspace 2 0; togglepane 1'
+ *
+ * "dzwmc subscribe [event...]" prints the events dzwm sends, one a line.
+ * "dzwmc stats" prints the counters of the stats module.
+ *
+ * "dzwmc -b count command" sends the command count times, each after the
+ * reply to the one before, and prints the commands per second and the
+ * round-trip latency:
+ *
+ *   dzwmc -b 10000 'inc_div_ratio 0'
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "util.h"
+
+static FILE *in, *out;
+
+static double
+nowus(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int
+send_line(const char *line, int quiet)
+{
+  char reply[256];
+
+  if (fprintf(out, "%s\n", line) < 0 || fflush(out) == EOF
+      || !fgets(reply, sizeof reply, in))
+    die("dzwmc: lost the connection to dzwm");
+  if (!quiet || strncmp(reply, "ok", 2))
+    fputs(reply, stdout);
+  return strncmp(reply, "ok", 2) != 0;
+}
+
+static int
+bench(long count, const char *line)
+{
+  double t0, t, lat, max = 0;
+  long i;
+
+  if (count < 1)
+    die("usage: dzwmc -b count command");
+  t0 = nowus();
+  for (i = 0; i < count; i++) {
+    t = nowus();
+    if (send_line(line, 1))
+      return 1;
+    lat = nowus() - t;
+    max = MAX(max, lat);
+  }
+  t = nowus() - t0;
+  printf("%ld commands in %.3f s: %.0f/s, latency %.1f us mean, %.1f us max\n",
+	 count, t / 1e6, count * 1e6 / t, t / count, max);
+  return 0;
+}
+
+/* events come as a 4 byte big endian length and the text */
+static int
+subscribe(void)
+{
+  unsigned char hdr[4];
+  char ev[512];
+  size_t len;
+
+  while (fread(hdr, 1, 4, in) == 4) {
+    len = (size_t)hdr[0] << 24 | hdr[1] << 16 | hdr[2] << 8 | hdr[3];
+    if (len >= sizeof ev || fread(ev, 1, len, in) != len)
+      die("dzwmc: bad event from dzwm");
+    ev[len] = '\0';
+    puts(ev);
+    fflush(stdout);
+  }
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct sockaddr_un sa = { .sun_family = AF_UNIX };
+  char line[1024];
+  const char *p;
+  size_t len = 0;
+  int fd, i, err = 0;
+
+  if ((p = getenv("DZWM_SOCKET")))
+    snprintf(sa.sun_path, sizeof sa.sun_path, "%s", p);
+  else if (!(p = getenv("DISPLAY")))
+    die("dzwmc: neither DZWM_SOCKET nor DISPLAY is set");
+  else if (sockpath(sa.sun_path, sizeof sa.sun_path, p) == -1)
+    die("dzwmc: no socket path:");
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1
+      || connect(fd, (struct sockaddr *)&sa, sizeof sa) == -1)
+    die("dzwmc: cannot connect to %s:", sa.sun_path);
+  if (!(in = fdopen(fd, "r")) || !(out = fdopen(dup(fd), "w")))
+    die("fdopen:");
+
+  if (argc == 4 && !strcmp(argv[1], "-b"))
+    return bench(atol(argv[2]), argv[3]);
+  if (argc > 1) {
+    line[0] = '\0';
+    for (i = 1; i < argc && len < sizeof line; i++)
+      len += snprintf(line + len, sizeof line - len, "%s%s", i > 1 ? " " : "", argv[i]);
+    if (send_line(line, 0))
+      return 1;
+    return strcmp(argv[1], "subscribe") ? 0 : subscribe();
+  }
+  while (fgets(line, sizeof line, stdin)) {
+    line[strcspn(line, "\n")] = '\0';
+    err |= send_line(line, 0);
+  }
+  return err;
+}
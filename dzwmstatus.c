@@ -0,0 +1,61 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dzwmstatus publishes status frames read from standard input into a
+ * slot of dzwm's shared status region. A frame is a run of lines of
+ * scheme<TAB>pad<TAB>text ended by an empty line or the end of input:
+ *
+ *   while :; do printf '2\t4\t%s\n\n' "$(date +%s)"; sleep 1; done | dzwmstatus -s 0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shmstatus.h"
+#include "util.h"
+
+static void
+usage(void)
+{
+  die("usage: dzwmstatus [-n name] [-s slot]");
+}
+
+int
+main(int argc, char *argv[])
+{
+  char frame[SHMS_SEGS * (SHMS_TEXT + 32)], line[SHMS_TEXT + 32];
+  const char *name = NULL;
+  unsigned slot = 0;
+  size_t len = 0, n;
+  ShmStatus *s;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc)
+      name = argv[++i];
+    else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+      slot = strtoul(argv[++i], NULL, 10);
+    else
+      usage();
+  }
+  if (slot >= SHMS_SLOTS)
+    die("dzwmstatus: slot must be below %d", SHMS_SLOTS);
+  if (!(s = shms_open(name, 1)))
+    die("dzwmstatus: cannot open the status region:");
+
+  frame[0] = '\0';
+  while (fgets(line, sizeof line, stdin)) {
+    if (line[0] == '\n') {
+      shms_publishtext(s, slot, frame);
+      frame[len = 0] = '\0';
+      continue;
+    }
+    if (len + (n = strlen(line)) < sizeof frame) {
+      memcpy(frame + len, line, n + 1);
+      len += n;
+    }
+  }
+  if (len)
+    shms_publishtext(s, slot, frame);
+  shms_close(s);
+  return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# See LICENSE file for copyright and license details.
+#
+# edgesweep.sh counts how often dzwm wakes up while xdotool sweeps the
+# pointer from the left of the screen to the right, sweeps times, and
+# how often it wakes up over the same time with the pointer at rest.
+# Run it over the bare desktop of a dzwm that selects PointerMotionMask
+# on root and of one that tracks the monitor by crossing events, to
+# compare the two.
+#
+#   edgesweep.sh [sweeps [step]]
+
+sweeps=${1:-10}
+step=${2:-4}
+
+wakeups() {
+	dzwmc stats | sed -n 's/^ok wakeups \([0-9]*\) .*/\1/p'
+}
+
+eval "$(xdotool getdisplaygeometry --shell)" || exit 1
+y=$((HEIGHT / 2))
+moves=0
+path=
+x=0
+while [ "$x" -lt "$WIDTH" ]; do
+	path="$path mousemove $x $y sleep 0.001"
+	moves=$((moves + 1))
+	x=$((x + step))
+done
+
+# asking dzwm for its counters wakes it up as well
+a=$(wakeups)
+b=$(wakeups)
+ask=$((b - a))
+
+start=$(date +%s)
+a=$(wakeups)
+i=0
+while [ "$i" -lt "$sweeps" ]; do
+	xdotool $path
+	i=$((i + 1))
+done
+b=$(wakeups)
+secs=$(($(date +%s) - start))
+swept=$((b - a - ask))
+
+a=$(wakeups)
+sleep "$secs"
+b=$(wakeups)
+idle=$((b - a - ask))
+
+echo "$((moves * sweeps)) moves in ${secs}s: $swept wakeups, $idle at rest"
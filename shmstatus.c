@@ -0,0 +1,250 @@
+/* See LICENSE file for copyright and license details. */
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "shmstatus.h"
+
+#define SHMS_MAGIC 0x647a7331 /* "dzs1" */
+#define SPINS      10000      /* yields before a writer is taken for dead */
+#define READS      100
+#define WAITNS     20000000   /* how often a waiter looks at gen without futexes */
+
+typedef struct {
+  uint32_t seq; /* odd while a producer writes the slot */
+  uint32_t n;
+  ShmSeg segs[SHMS_SEGS];
+} Slot;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t gen;     /* bumped after every publish, the futex word */
+  uint32_t waiters; /* set while someone sleeps on gen */
+  Slot slots[SHMS_SLOTS];
+} Region;
+
+struct ShmStatus {
+  Region *r;
+};
+
+#ifdef __linux__
+static long
+futex(uint32_t *addr, int op, uint32_t val)
+{
+  return syscall(SYS_futex, addr, op, val, NULL, NULL, 0);
+}
+#else
+/* a waiter sleeps a little and looks again, a wake has nothing to do */
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+static long
+futex(uint32_t *addr, int op, uint32_t val)
+{
+  struct timespec ts = { 0, WAITNS };
+
+  if (op == FUTEX_WAIT)
+    nanosleep(&ts, NULL);
+  return 0;
+}
+#endif
+
+ShmStatus *
+shms_open(const char *name, int create)
+{
+  char buf[64];
+  struct stat st;
+  ShmStatus *s;
+  uint32_t magic = 0;
+  void *p;
+  int fd;
+
+  if (!name) {
+    snprintf(buf, sizeof buf, "/dzwm-status.%u", (unsigned)getuid());
+    name = buf;
+  }
+  if ((fd = shm_open(name, O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0600)) == -1)
+    return NULL;
+  /* a new region is zero filled, which is a valid empty one */
+  if (fstat(fd, &st) == -1
+      || (st.st_size < (off_t)sizeof(Region)
+	  && (!create || ftruncate(fd, sizeof(Region)) == -1))) {
+    close(fd);
+    return NULL;
+  }
+  p = mmap(NULL, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return NULL;
+  /* refuse a region laid out by another version */
+  if (!__atomic_compare_exchange_n(&((Region *)p)->magic, &magic, SHMS_MAGIC, 0,
+				   __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+      && magic != SHMS_MAGIC) {
+    munmap(p, sizeof(Region));
+    return NULL;
+  }
+  if (!(s = calloc(1, sizeof(ShmStatus)))) {
+    munmap(p, sizeof(Region));
+    return NULL;
+  }
+  s->r = p;
+  return s;
+}
+
+void
+shms_close(ShmStatus *s)
+{
+  if (!s)
+    return;
+  munmap(s->r, sizeof(Region));
+  free(s);
+}
+
+int
+shms_publish(ShmStatus *s, unsigned slot, const ShmSeg *segs, unsigned n)
+{
+  Slot *sl;
+  uint32_t seq, next;
+  unsigned i;
+  int spins = 0;
+
+  if (slot >= SHMS_SLOTS)
+    return -1;
+  sl = &s->r->slots[slot];
+  if (n > SHMS_SEGS)
+    n = SHMS_SEGS;
+
+  /* the seqlock also keeps producers of the same slot apart */
+again:
+  for (;;) {
+    seq = __atomic_load_n(&sl->seq, __ATOMIC_RELAXED);
+    if (seq & 1 && ++spins < SPINS) {
+      sched_yield();
+      continue;
+    }
+    /* still odd after all that: its writer died in the middle */
+    next = seq & 1 ? seq + 2 : seq + 1;
+    if (__atomic_compare_exchange_n(&sl->seq, &seq, next, 0,
+				    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+      break;
+  }
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for (i = 0; i < n; i++) {
+    sl->segs[i].scheme = segs[i].scheme;
+    sl->segs[i].pad = segs[i].pad;
+    memcpy(sl->segs[i].text, segs[i].text, SHMS_TEXT - 1);
+    sl->segs[i].text[SHMS_TEXT - 1] = '\0';
+  }
+  sl->n = n;
+  /* a producer that took us for dead owns the slot now and may have
+   * seen part of our frame mixed into its own: write ours again whole */
+  seq = next;
+  if (!__atomic_compare_exchange_n(&sl->seq, &seq, next + 1, 0,
+				   __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    spins = 0;
+    goto again;
+  }
+
+  __atomic_add_fetch(&s->r->gen, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_exchange_n(&s->r->waiters, 0, __ATOMIC_SEQ_CST))
+    futex(&s->r->gen, FUTEX_WAKE, INT_MAX);
+  return 0;
+}
+
+int
+shms_publishtext(ShmStatus *s, unsigned slot, const char *text)
+{
+  ShmSeg segs[SHMS_SEGS];
+  const char *p = text, *end;
+  char *q;
+  unsigned n = 0;
+  long v;
+  size_t len;
+
+  for (; *p && n < SHMS_SEGS; p = *end ? end + 1 : end) {
+    end = p + strcspn(p, "\n");
+    v = strtol(p, &q, 10);
+    if (*q != '\t' || q >= end)
+      continue;
+    segs[n].scheme = v;
+    v = strtol(q + 1, &q, 10);
+    if (*q != '\t' || q >= end)
+      continue;
+    segs[n].pad = v;
+    len = end - (q + 1);
+    if (len > SHMS_TEXT - 1)
+      len = SHMS_TEXT - 1;
+    memcpy(segs[n].text, q + 1, len);
+    segs[n].text[len] = '\0';
+    n++;
+  }
+  return shms_publish(s, slot, segs, n);
+}
+
+int
+shms_read(ShmStatus *s, unsigned slot, ShmSeg *segs, unsigned n)
+{
+  Slot *sl;
+  uint32_t seq, m, j;
+  int i;
+
+  if (slot >= SHMS_SLOTS)
+    return -1;
+  sl = &s->r->slots[slot];
+  for (i = 0; i < READS; i++) {
+    if ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1) {
+      sched_yield();
+      continue;
+    }
+    m = __atomic_load_n(&sl->n, __ATOMIC_RELAXED);
+    if (m > n)
+      m = n;
+    memcpy(segs, sl->segs, m * sizeof(ShmSeg));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&sl->seq, __ATOMIC_RELAXED) == seq) {
+      for (j = 0; j < m; j++)
+	segs[j].text[SHMS_TEXT - 1] = '\0';
+      return m;
+    }
+  }
+  return -1;
+}
+
+uint32_t
+shms_gen(ShmStatus *s)
+{
+  return __atomic_load_n(&s->r->gen, __ATOMIC_ACQUIRE);
+}
+
+uint32_t
+shms_wait(ShmStatus *s, uint32_t gen)
+{
+  uint32_t g;
+
+  /* a publisher bumps gen before it looks at waiters, so either it
+   * sees us here or we see its gen below */
+  __atomic_store_n(&s->r->waiters, 1, __ATOMIC_SEQ_CST);
+  while ((g = __atomic_load_n(&s->r->gen, __ATOMIC_SEQ_CST)) == gen) {
+    futex(&s->r->gen, FUTEX_WAIT, gen);
+    __atomic_store_n(&s->r->waiters, 1, __ATOMIC_SEQ_CST);
+  }
+  return g;
+}
+
+void
+shms_wake(ShmStatus *s)
+{
+  __atomic_add_fetch(&s->r->gen, 1, __ATOMIC_SEQ_CST);
+  futex(&s->r->gen, FUTEX_WAKE, INT_MAX);
+}
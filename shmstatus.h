@@ -0,0 +1,40 @@
+/* See LICENSE file for copyright and license details. */
+
+/* Status segments shared with external producers through POSIX shared
+ * memory. The region holds SHMS_SLOTS slots, each a frame of segments
+ * in the scheme, pad, text terms of the status files. A slot is guarded
+ * by a seqlock, so a reader never blocks a producer and copies a frame
+ * without a system call. Publishing bumps a generation counter that a
+ * waiter sleeps on as a futex; the futex is only woken when someone is
+ * waiting. Without Linux futexes a waiter looks at the counter every
+ * 20 ms instead. */
+
+#include <stdint.h>
+
+#define SHMS_SLOTS 8
+#define SHMS_SEGS  16
+#define SHMS_TEXT  256
+
+typedef struct {
+  int32_t scheme;
+  int32_t pad;
+  char text[SHMS_TEXT];
+} ShmSeg;
+
+typedef struct ShmStatus ShmStatus;
+
+/* name NULL is /dzwm-status.<uid>; create makes the region if needed */
+ShmStatus *shms_open(const char *name, int create);
+void shms_close(ShmStatus *s);
+
+int shms_publish(ShmStatus *s, unsigned slot, const ShmSeg *segs, unsigned n);
+/* lines of scheme<TAB>pad<TAB>text, the first one drawn rightmost */
+int shms_publishtext(ShmStatus *s, unsigned slot, const char *text);
+/* the latest frame of slot, -1 if a producer died while writing it */
+int shms_read(ShmStatus *s, unsigned slot, ShmSeg *segs, unsigned n);
+
+uint32_t shms_gen(ShmStatus *s);
+/* sleep until the generation differs from gen, return the new one */
+uint32_t shms_wait(ShmStatus *s, uint32_t gen);
+/* bump the generation without publishing, to release a waiter */
+void shms_wake(ShmStatus *s);
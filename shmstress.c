@@ -0,0 +1,117 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * shmstress is the stress test of the shared status region. Producer
+ * processes publish to one slot at 1 kHz each, every segment of a frame
+ * carrying the producer and frame number. Meanwhile the reader copies
+ * the slot as fast as it can and counts the copies that mix two frames.
+ * It fails on a torn copy or when the generation does not match the
+ * number of publishes.
+ *
+ *   shmstress [producers [seconds]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "shmstatus.h"
+#include "util.h"
+
+#define SLOT    3
+#define PERIOD  1000000 /* ns between the frames of a producer */
+
+static void
+fill(ShmSeg *seg, int id, int frame)
+{
+  int len;
+
+  seg->scheme = id;
+  seg->pad = frame;
+  len = snprintf(seg->text, SHMS_TEXT, "%d.%d ", id, frame);
+  memset(seg->text + len, 'a' + id % 26, SHMS_TEXT - 1 - len);
+  seg->text[SHMS_TEXT - 1] = '\0';
+}
+
+static void
+produce(const char *name, int id, int seconds)
+{
+  ShmSeg segs[SHMS_SEGS];
+  struct timespec t;
+  ShmStatus *s;
+  int frame, i;
+
+  if (!(s = shms_open(name, 0)))
+    die("shmstress: cannot open %s:", name);
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  for (frame = 0; frame < seconds * (1000000000 / PERIOD); frame++) {
+    for (i = 0; i < SHMS_SEGS; i++)
+      fill(&segs[i], id, frame);
+    shms_publish(s, SLOT, segs, SHMS_SEGS);
+    if ((t.tv_nsec += PERIOD) >= 1000000000) {
+      t.tv_sec++;
+      t.tv_nsec -= 1000000000;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+  }
+  shms_close(s);
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  ShmSeg segs[SHMS_SEGS], want;
+  unsigned long reads = 0, torn = 0, busy = 0, frames;
+  char name[64];
+  ShmStatus *s;
+  uint32_t gen0;
+  int producers = argc > 1 ? atoi(argv[1]) : 4;
+  int seconds = argc > 2 ? atoi(argv[2]) : 5;
+  int i, n, st, live, err = 0;
+
+  if (producers < 1 || seconds < 1)
+    die("usage: shmstress [producers [seconds]]");
+  snprintf(name, sizeof name, "/dzwm-stress.%d", (int)getpid());
+  if (!(s = shms_open(name, 1)))
+    die("shmstress: cannot create %s:", name);
+  gen0 = shms_gen(s);
+  for (i = 0; i < producers; i++)
+    switch (fork()) {
+    case -1:
+      die("fork:");
+    case 0:
+      produce(name, i, seconds);
+    }
+
+  for (live = producers; live; ) {
+    if ((n = shms_read(s, SLOT, segs, SHMS_SEGS)) == -1)
+      busy++;
+    else if (n) {
+      reads++;
+      fill(&want, segs[0].scheme, segs[0].pad);
+      for (i = 0; i < n; i++)
+	if (n != SHMS_SEGS || memcmp(&segs[i], &want, sizeof want)) {
+	  torn++;
+	  break;
+	}
+    }
+    while (live && waitpid(-1, &st, WNOHANG) > 0) {
+      live--;
+      if (!WIFEXITED(st) || WEXITSTATUS(st))
+	err = 1;
+    }
+  }
+
+  frames = (unsigned long)producers * seconds * (1000000000 / PERIOD);
+  printf("%d producers, %d s: %lu frames, %lu reads, %lu torn, %lu busy, gen %lu\n",
+	 producers, seconds, frames, reads, torn, busy,
+	 (unsigned long)(shms_gen(s) - gen0));
+  if (torn || shms_gen(s) - gen0 != frames)
+    err = 1;
+  shms_close(s);
+  shm_unlink(name);
+  return err;
+}
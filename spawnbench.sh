@@ -0,0 +1,44 @@
+#!/bin/sh
+# See LICENSE file for copyright and license details.
+#
+# spawnbench.sh measures the key-to-visible latency of spawn(). It
+# presses keys with xdotool count times, by default the termcmd binding.
+# Each time it waits until dzwm has seen the new window mapped, reads
+# dzwm's spawn-to-map time and closes the window again. Run it once
+# with termcmd in poolcmds and once without, to compare the two.
+#
+#   spawnbench.sh [count [keys]]
+
+count=${1:-20}
+keys=${2:-super+shift+Return}
+
+stat() {
+	dzwmc stats | sed -n "s/^ok .* $1 \([0-9]*\).*/\1/p"
+}
+
+i=0
+sum=0
+max=0
+adopted=$(stat adopted)
+while [ "$i" -lt "$count" ]; do
+	maps=$(stat maps)
+	xdotool key "$keys"
+	tries=0
+	while [ "$(stat maps)" = "$maps" ]; do
+		tries=$((tries + 1))
+		if [ "$tries" -gt 500 ]; then
+			echo "spawnbench.sh: no window was mapped" >&2
+			exit 1
+		fi
+		sleep 0.01
+	done
+	us=$(stat map)
+	sum=$((sum + us))
+	[ "$us" -gt "$max" ] && max=$us
+	dzwmc killclient >/dev/null
+	sleep 0.2
+	i=$((i + 1))
+done
+
+echo "$count spawns, $(($(stat adopted) - adopted)) from the pool:" \
+	"$((sum / count))us mean, ${max}us max"
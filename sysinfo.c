@@ -0,0 +1,211 @@
+/* See LICENSE file for copyright and license details. */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/statvfs.h>
+
+#include "sysinfo.h"
+
+typedef struct {
+  char path[128];
+  int fd, isopen;
+} SysFile;
+
+/* Read the file at path from the start, reusing the descriptor of the
+ * previous read of the same path. */
+static ssize_t
+sysread(SysFile *f, const char *path, char *buf, size_t size)
+{
+  ssize_t n;
+
+  if (f->isopen && strcmp(f->path, path)) {
+    close(f->fd);
+    f->isopen = 0;
+  }
+  if (!f->isopen) {
+    if ((f->fd = open(path, O_RDONLY | O_CLOEXEC)) == -1)
+      return -1;
+    snprintf(f->path, sizeof f->path, "%s", path);
+    f->isopen = 1;
+  }
+  /* a battery or a network device may have gone away */
+  if ((n = pread(f->fd, buf, size - 1, 0)) == -1) {
+    close(f->fd);
+    f->isopen = 0;
+    return -1;
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+/* the next decimal number in *s, which is moved past it */
+static unsigned long long
+nextnum(const char **s)
+{
+  unsigned long long v = 0;
+  const char *p = *s;
+
+  while (*p && (*p < '0' || *p > '9'))
+    p++;
+  for (; *p >= '0' && *p <= '9'; p++)
+    v = v * 10 + (*p - '0');
+  *s = p;
+  return v;
+}
+
+/* the number following key in buf, 0 if there is none */
+static unsigned long long
+field(const char *buf, const char *key)
+{
+  const char *p = strstr(buf, key);
+
+  return p ? (p += strlen(key), nextnum(&p)) : 0;
+}
+
+static double
+elapsed(struct timespec *last)
+{
+  struct timespec now;
+  double dt;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  dt = (now.tv_sec - last->tv_sec) + (now.tv_nsec - last->tv_nsec) / 1e9;
+  *last = now;
+  return dt;
+}
+
+int
+si_cpu(void)
+{
+  static SysFile f;
+  static unsigned long long lastbusy, lasttotal;
+  unsigned long long v, busy = 0, total = 0, dtotal;
+  char buf[256];
+  const char *p = buf;
+  int i;
+
+  /* the first line sums all cpus: user nice system idle iowait irq ... */
+  if (sysread(&f, "/proc/stat", buf, sizeof buf) < 4 || strncmp(buf, "cpu ", 4))
+    return -1;
+  for (i = 0; i < 8; i++) {
+    v = nextnum(&p);
+    total += v;
+    if (i != 3 && i != 4)
+      busy += v;
+  }
+  dtotal = total - lasttotal;
+  v = busy - lastbusy;
+  lastbusy = busy;
+  lasttotal = total;
+  return dtotal ? (int)(v * 100 / dtotal) : 0;
+}
+
+int
+si_mem(SysMem *mem)
+{
+  static SysFile f;
+  char buf[512];
+
+  if (sysread(&f, "/proc/meminfo", buf, sizeof buf) == -1)
+    return -1;
+  mem->total = field(buf, "MemTotal:");
+  mem->avail = field(buf, "MemAvailable:");
+  return mem->total ? 0 : -1;
+}
+
+int
+si_load(double load[3])
+{
+  static SysFile f;
+  char buf[128], *p = buf;
+  int i;
+
+  if (sysread(&f, "/proc/loadavg", buf, sizeof buf) == -1)
+    return -1;
+  for (i = 0; i < 3; i++)
+    load[i] = strtod(p, &p);
+  return 0;
+}
+
+int
+si_battery(const char *name, int *capacity, char *status, size_t size)
+{
+  static SysFile fcap, fstatus;
+  char path[128], buf[32];
+  const char *p = buf;
+
+  snprintf(path, sizeof path, "/sys/class/power_supply/%s/capacity", name);
+  if (sysread(&fcap, path, buf, sizeof buf) == -1)
+    return -1;
+  *capacity = nextnum(&p);
+  snprintf(path, sizeof path, "/sys/class/power_supply/%s/status", name);
+  if (sysread(&fstatus, path, buf, sizeof buf) == -1)
+    return -1;
+  buf[strcspn(buf, "\n")] = '\0';
+  snprintf(status, size, "%s", buf);
+  return 0;
+}
+
+int
+si_net(const char *iface, SysNet *net)
+{
+  static SysFile frx, ftx;
+  static unsigned long long lastrx, lasttx;
+  static struct timespec last;
+  static const char *lastiface;
+  unsigned long long rx, tx;
+  char path[128], buf[32];
+  const char *p;
+  double dt;
+
+  snprintf(path, sizeof path, "/sys/class/net/%s/statistics/rx_bytes", iface);
+  if (sysread(&frx, path, buf, sizeof buf) == -1)
+    return -1;
+  p = buf;
+  rx = nextnum(&p);
+  snprintf(path, sizeof path, "/sys/class/net/%s/statistics/tx_bytes", iface);
+  if (sysread(&ftx, path, buf, sizeof buf) == -1)
+    return -1;
+  p = buf;
+  tx = nextnum(&p);
+
+  dt = elapsed(&last);
+  if (iface != lastiface || rx < lastrx || tx < lasttx || dt <= 0) {
+    net->rx = net->tx = 0;
+  } else {
+    net->rx = (rx - lastrx) / dt;
+    net->tx = (tx - lasttx) / dt;
+  }
+  lastiface = iface;
+  lastrx = rx;
+  lasttx = tx;
+  return 0;
+}
+
+int
+si_disk(const char *path, SysDisk *disk)
+{
+  struct statvfs fs;
+
+  if (statvfs(path, &fs) == -1)
+    return -1;
+  disk->total = (unsigned long long)fs.f_blocks * fs.f_frsize;
+  disk->avail = (unsigned long long)fs.f_bavail * fs.f_frsize;
+  return 0;
+}
+
+int
+si_thermal(const char *zone)
+{
+  static SysFile f;
+  char path[128], buf[32];
+  const char *p = buf;
+
+  snprintf(path, sizeof path, "/sys/class/thermal/%s/temp", zone);
+  if (sysread(&f, path, buf, sizeof buf) == -1)
+    return -1;
+  return nextnum(&p) / 1000;
+}
@@ -0,0 +1,26 @@
+/* See LICENSE file for copyright and license details. */
+
+/* Readers of the kernel's /proc and /sys files for the status bar. Each
+ * keeps its file open and rereads it with pread into a fixed buffer, so
+ * an update costs a system call or two and no allocation. They return
+ * -1 when the source cannot be read. */
+
+typedef struct {
+  unsigned long total, avail; /* kB */
+} SysMem;
+
+typedef struct {
+  double rx, tx; /* bytes per second */
+} SysNet;
+
+typedef struct {
+  unsigned long long total, avail; /* bytes */
+} SysDisk;
+
+int si_cpu(void); /* percent busy since the previous call */
+int si_mem(SysMem *mem);
+int si_load(double load[3]);
+int si_battery(const char *name, int *capacity, char *status, size_t size);
+int si_net(const char *iface, SysNet *net);
+int si_disk(const char *path, SysDisk *disk);
+int si_thermal(const char *zone); /* degrees Celsius */
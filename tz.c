@@ -0,0 +1,337 @@
+/* See LICENSE file for copyright and license details. */
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tz.h"
+#include "util.h"
+
+#define TZDIR    "/usr/share/zoneinfo"
+#define TZIF_MAX (1 << 20)
+
+typedef struct {
+  long off; /* seconds east of UTC */
+  int isdst;
+} ZoneType;
+
+/* a transition date of a POSIX TZ rule: Jn, n or Mm.w.d, then a time */
+typedef struct {
+  int kind, m, w, d;
+  long time; /* seconds after local midnight */
+} ZoneDate;
+
+struct Zone {
+  char name[64];
+  int64_t *trans;
+  unsigned char *idx;
+  size_t ntrans;
+  ZoneType *types;
+  size_t ntypes;
+  /* the TZ string for times after the last transition */
+  int hasrule, hasdst;
+  long stdoff, dstoff;
+  ZoneDate start, end;
+  Zone *next;
+};
+
+static Zone *zones;
+
+static long long
+civil(long long y, int m, int d)
+{
+  long long era, yoe, doy, doe;
+
+  y -= m <= 2;
+  era = (y >= 0 ? y : y - 399) / 400;
+  yoe = y - era * 400;
+  doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+static int
+isleap(long long y)
+{
+  return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+static const char *
+parsenum(const char *s, int *v, int min, int max)
+{
+  if (!isdigit((unsigned char)*s))
+    return NULL;
+  for (*v = 0; isdigit((unsigned char)*s); s++)
+    if ((*v = *v * 10 + (*s - '0')) > max)
+      return NULL;
+  return *v < min ? NULL : s;
+}
+
+static const char *
+parsename(const char *s)
+{
+  const char *p = s;
+
+  if (*p == '<') {
+    if (!(p = strchr(p, '>')))
+      return NULL;
+    return p + 1;
+  }
+  while (isalpha((unsigned char)*p))
+    p++;
+  return p - s >= 3 ? p : NULL;
+}
+
+/* [+-]hh[:mm[:ss]] */
+static const char *
+parsetime(const char *s, long *secs)
+{
+  int sign = 1, h, m = 0, sec = 0;
+
+  if (*s == '+' || *s == '-')
+    sign = *s++ == '-' ? -1 : 1;
+  if (!(s = parsenum(s, &h, 0, 167)))
+    return NULL;
+  if (*s == ':' && !(s = parsenum(s + 1, &m, 0, 59)))
+    return NULL;
+  if (s && *s == ':' && !(s = parsenum(s + 1, &sec, 0, 59)))
+    return NULL;
+  *secs = sign * (h * 3600L + m * 60 + sec);
+  return s;
+}
+
+static const char *
+parsedate(const char *s, ZoneDate *d)
+{
+  d->kind = *s;
+  if (*s == 'J') {
+    s = parsenum(s + 1, &d->d, 1, 365);
+  } else if (*s == 'M') {
+    if ((s = parsenum(s + 1, &d->m, 1, 12)) && *s == '.'
+	&& (s = parsenum(s + 1, &d->w, 1, 5)) && *s == '.')
+      s = parsenum(s + 1, &d->d, 0, 6);
+    else
+      s = NULL;
+  } else {
+    d->kind = 'n';
+    s = parsenum(s, &d->d, 0, 365);
+  }
+  d->time = 7200;
+  if (s && *s == '/')
+    s = parsetime(s + 1, &d->time);
+  return s;
+}
+
+/* POSIX TZ string, e.g. "EST5EDT,M3.2.0,M11.1.0" or "<+07>-7" */
+static int
+parserule(Zone *z, const char *s)
+{
+  long off;
+
+  if (!(s = parsename(s)) || !(s = parsetime(s, &off)))
+    return 0;
+  z->stdoff = -off;
+  if (!*s)
+    return z->hasrule = 1;
+  if (!(s = parsename(s)))
+    return 0;
+  z->dstoff = z->stdoff + 3600;
+  if (*s && *s != ',') {
+    if (!(s = parsetime(s, &off)))
+      return 0;
+    z->dstoff = -off;
+  }
+  if (!*s)
+    s = ",M3.2.0,M11.1.0"; /* what tzcode assumes */
+  if (*s != ',' || !(s = parsedate(s + 1, &z->start))
+      || *s != ',' || !(s = parsedate(s + 1, &z->end)) || *s)
+    return 0;
+  z->hasdst = 1;
+  return z->hasrule = 1;
+}
+
+/* the transition to ZoneDate d in year y, in seconds of local time */
+static long long
+ruletime(const ZoneDate *d, long long y)
+{
+  static const int mdays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  long long days, first;
+  int wd, day, n;
+
+  switch (d->kind) {
+  case 'J':
+    days = civil(y, 1, 1) + d->d - 1 + (isleap(y) && d->d > 59);
+    break;
+  case 'M':
+    first = civil(y, d->m, 1);
+    wd = ((first % 7) + 11) % 7; /* 1970-01-01 was a Thursday */
+    n = mdays[d->m - 1] + (d->m == 2 && isleap(y));
+    day = (d->d - wd + 7) % 7 + (d->w - 1) * 7;
+    while (day >= n)
+      day -= 7;
+    days = first + day;
+    break;
+  default:
+    days = civil(y, 1, 1) + d->d;
+    break;
+  }
+  return days * 86400 + d->time;
+}
+
+static long
+ruleoffset(const Zone *z, time_t t, int *isdst)
+{
+  long long start, end;
+  time_t local = t + z->stdoff;
+  struct tm tm;
+
+  *isdst = 0;
+  if (!z->hasdst)
+    return z->stdoff;
+  gmtime_r(&local, &tm);
+  start = ruletime(&z->start, tm.tm_year + 1900LL) - z->stdoff;
+  end = ruletime(&z->end, tm.tm_year + 1900LL) - z->dstoff;
+  if (start < end)
+    *isdst = t >= start && t < end;
+  else
+    *isdst = t < end || t >= start;
+  return *isdst ? z->dstoff : z->stdoff;
+}
+
+static uint32_t
+be32(const unsigned char *p)
+{
+  return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static int
+parsetzif(Zone *z, const unsigned char *buf, size_t len)
+{
+  const unsigned char *p = buf, *end = buf + len, *q;
+  uint32_t isut, isstd, leap, timecnt, typecnt, charcnt;
+  size_t tsize = 4, i, n;
+  char rule[128];
+
+  if (len < 44 || memcmp(p, "TZif", 4))
+    return 0;
+  for (;;) {
+    isut = be32(p + 20);
+    isstd = be32(p + 24);
+    leap = be32(p + 28);
+    timecnt = be32(p + 32);
+    typecnt = be32(p + 36);
+    charcnt = be32(p + 40);
+    n = 44 + timecnt * (tsize + 1) + typecnt * 6 + charcnt
+	+ leap * (tsize + 4) + isstd + isut;
+    if (!typecnt || n > (size_t)(end - p))
+      return 0;
+    /* version 2 and up repeat the data with 64 bit times */
+    if (tsize == 4 && p[4] >= '2' && (size_t)(end - p) >= n + 44
+	&& !memcmp(p + n, "TZif", 4)) {
+      p += n;
+      tsize = 8;
+      continue;
+    }
+    break;
+  }
+
+  z->ntrans = timecnt;
+  z->trans = ecalloc(timecnt + 1, sizeof(int64_t));
+  z->idx = ecalloc(timecnt + 1, 1);
+  z->ntypes = typecnt;
+  z->types = ecalloc(typecnt, sizeof(ZoneType));
+  q = p + 44;
+  for (i = 0; i < timecnt; i++, q += tsize)
+    z->trans[i] = tsize == 8
+      ? (int64_t)((uint64_t)be32(q) << 32 | be32(q + 4))
+      : (int64_t)(int32_t)be32(q);
+  for (i = 0; i < timecnt; i++, q++)
+    z->idx[i] = *q < typecnt ? *q : 0;
+  for (i = 0; i < typecnt; i++, q += 6) {
+    z->types[i].off = (int32_t)be32(q);
+    z->types[i].isdst = q[4];
+  }
+
+  /* the footer: a TZ string between newlines */
+  q = p + n;
+  if (tsize == 8 && q < end && *q == '\n') {
+    for (i = 0, q++; q < end && *q != '\n' && i < sizeof rule - 1; q++)
+      rule[i++] = *q;
+    rule[i] = '\0';
+    if (i)
+      parserule(z, rule);
+  }
+  return 1;
+}
+
+static int
+loadzone(Zone *z, const char *name)
+{
+  char path[300];
+  unsigned char *buf;
+  size_t len;
+  FILE *fp;
+  int ok = 0;
+
+  if (*name == ':')
+    name++;
+  snprintf(path, sizeof path, "%s%s%s", *name == '/' ? "" : TZDIR,
+	   *name == '/' ? "" : "/", name);
+  if ((fp = fopen(path, "rb"))) {
+    buf = ecalloc(1, TZIF_MAX);
+    len = fread(buf, 1, TZIF_MAX, fp);
+    ok = parsetzif(z, buf, len);
+    free(buf);
+    fclose(fp);
+  }
+  /* not a zone file, maybe a rule like "JST-9" */
+  return ok || parserule(z, name);
+}
+
+/* The zone called name, as in TZ: a zoneinfo name, a path or a POSIX
+ * rule. Zones that cannot be loaded are taken as UTC. */
+const Zone *
+tz_zone(const char *name)
+{
+  Zone *z;
+
+  for (z = zones; z; z = z->next)
+    if (!strcmp(z->name, name))
+      return z;
+  z = ecalloc(1, sizeof(Zone));
+  snprintf(z->name, sizeof z->name, "%s", name);
+  if (!loadzone(z, name))
+    fprintf(stderr, "dzwm: cannot load time zone '%s', using UTC\n", name);
+  z->next = zones;
+  zones = z;
+  return z;
+}
+
+void
+tz_localtime(const Zone *z, time_t t, struct tm *tm)
+{
+  size_t lo, hi, mid;
+  long off = 0;
+  int isdst = 0;
+
+  if (!z) {
+  } else if (z->hasrule && (!z->ntrans || t >= z->trans[z->ntrans - 1])) {
+    off = ruleoffset(z, t, &isdst);
+  } else if (z->ntypes) {
+    /* the last transition at or before t */
+    for (lo = 0, hi = z->ntrans; lo < hi; ) {
+      mid = (lo + hi) / 2;
+      if (z->trans[mid] <= t)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+    off = z->types[lo ? z->idx[lo - 1] : 0].off;
+    isdst = z->types[lo ? z->idx[lo - 1] : 0].isdst;
+  }
+  t += off;
+  gmtime_r(&t, tm);
+  tm->tm_isdst = isdst;
+}
@@ -0,0 +1,10 @@
+/* See LICENSE file for copyright and license details. */
+
+/* Local time in any zone without going through TZ and tzset(). A zone's
+ * TZif file is read from the zoneinfo directory the first time the zone
+ * is asked for and kept for good. */
+
+typedef struct Zone Zone;
+
+const Zone *tz_zone(const char *name);
+void tz_localtime(const Zone *z, time_t t, struct tm *tm);
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include "util.h"
 
@@ -35,3 +37,33 @@ ecalloc(size_t nmemb, size_t size)
     die("calloc:");
   return p;
 }
+
+/* The default path of dzwm's command socket on display: in
+ * XDG_RUNTIME_DIR, or else in /tmp/dzwm-<uid>, which is made if missing
+ * and has to be our own directory closed to everybody else. Returns -1
+ * with errno set when there is no such path. */
+int
+sockpath(char *path, size_t size, const char *display)
+{
+  char tmp[32];
+  const char *dir;
+  struct stat st;
+
+  if (!(dir = getenv("XDG_RUNTIME_DIR"))) {
+    snprintf(tmp, sizeof tmp, "/tmp/dzwm-%lu", (unsigned long)getuid());
+    if (mkdir(tmp, 0700) == -1 && errno != EEXIST)
+      return -1;
+    if (lstat(tmp, &st) == -1)
+      return -1;
+    if (!S_ISDIR(st.st_mode) || st.st_uid != getuid() || st.st_mode & 077) {
+      errno = EPERM;
+      return -1;
+    }
+    dir = tmp;
+  }
+  if ((size_t)snprintf(path, size, "%s/dzwm%s.sock", dir, display) >= size) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  return 0;
+}
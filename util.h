@@ -7,3 +7,4 @@
 
 void die(const char *fmt, ...);
 void *ecalloc(size_t nmemb, size_t size);
+int sockpath(char *path, size_t size, const char *display);